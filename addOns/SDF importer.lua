@@ -52,6 +52,11 @@ function sysCall_init()
         [80] = {name = 'Prepare model', key = 'prepareModel'},
         [90] = {name = 'No self-collision', key = 'noSelfCollision'},
         [100] = {name = 'Position ctrl', key = 'positionCtrl'},
+        [110] = {name = 'Compound collisions', key = 'compoundCollisions'},
+        [120] = {name = 'Merge visuals', key = 'mergeVisuals'},
+        [130] = {name = 'Import collisions', key = 'importCollisions'},
+        [140] = {name = 'Import visuals', key = 'importVisuals'},
+        [150] = {name = 'Import sensors', key = 'importSensors'},
     }
 
     options = {
@@ -65,6 +70,11 @@ function sysCall_init()
         prepareModel = true,
         noSelfCollision = true,
         positionCtrl = true,
+        compoundCollisions = true,
+        mergeVisuals = false,
+        importCollisions = true,
+        importVisuals = true,
+        importSensors = true,
     }
 
     local scenePath = sim.getStringParam(sim.stringparam_scene_path)
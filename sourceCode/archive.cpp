@@ -0,0 +1,283 @@
+#include "archive.h"
+#include "util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include <zlib.h>
+
+namespace
+{
+    uint32_t le16(const char *p)
+    {
+        const unsigned char *u = reinterpret_cast<const unsigned char*>(p);
+        return u[0] | (u[1] << 8);
+    }
+
+    uint32_t le32(const char *p)
+    {
+        const unsigned char *u = reinterpret_cast<const unsigned char*>(p);
+        return uint32_t(u[0]) | (uint32_t(u[1]) << 8) | (uint32_t(u[2]) << 16) | (uint32_t(u[3]) << 24);
+    }
+
+    uint64_t octal(const char *p, size_t n)
+    {
+        uint64_t v = 0;
+        for(size_t i = 0; i < n && p[i]; i++)
+            if(p[i] >= '0' && p[i] <= '7')
+                v = v * 8 + (p[i] - '0');
+        return v;
+    }
+
+    std::string cstr(const char *p, size_t n)
+    {
+        return std::string(p, std::find(p, p + n, '\0'));
+    }
+
+    bool endsWith(const std::string &s, const std::string &suffix)
+    {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // windowBits selects the format: -MAX_WBITS for raw deflate, 16 + MAX_WBITS for gzip:
+    std::string inflateData(const char *data, size_t size, int windowBits, size_t sizeHint)
+    {
+        z_stream zs;
+        std::memset(&zs, 0, sizeof(zs));
+        if(inflateInit2(&zs, windowBits) != Z_OK)
+            throw std::runtime_error("inflateInit2 failed");
+        std::string out;
+        out.resize(std::max<size_t>(sizeHint, 4096));
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        zs.avail_in = size;
+        int ret = Z_OK;
+        while(ret != Z_STREAM_END)
+        {
+            if(zs.total_out == out.size())
+                out.resize(out.size() * 2);
+            zs.next_out = reinterpret_cast<Bytef*>(&out[zs.total_out]);
+            zs.avail_out = out.size() - zs.total_out;
+            ret = inflate(&zs, Z_NO_FLUSH);
+            if(ret == Z_BUF_ERROR && zs.avail_in == 0)
+                break;
+            if(ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+            {
+                inflateEnd(&zs);
+                throw std::runtime_error("corrupt compressed data");
+            }
+        }
+        out.resize(zs.total_out);
+        inflateEnd(&zs);
+        if(ret != Z_STREAM_END)
+            throw std::runtime_error("truncated compressed data");
+        return out;
+    }
+}
+
+bool isGzip(const std::string &data)
+{
+    return data.size() >= 2 && static_cast<unsigned char>(data[0]) == 0x1f && static_cast<unsigned char>(data[1]) == 0x8b;
+}
+
+std::string gunzip(const std::string &data)
+{
+    return inflateData(data.data(), data.size(), 16 + MAX_WBITS, data.size() * 4);
+}
+
+Archive::Archive(const std::string &path)
+    : path_(path)
+{
+    std::string lower = path;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if(endsWith(lower, ".zip"))
+    {
+        zip = true;
+        indexZip();
+    }
+    else
+    {
+        tarData = readFile(path);
+        if(isGzip(tarData))
+            tarData = gunzip(tarData);
+        indexTar(tarData);
+    }
+}
+
+bool Archive::isArchive(const std::string &path)
+{
+    std::string lower = path;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    return endsWith(lower, ".zip") || endsWith(lower, ".tar") || endsWith(lower, ".tar.gz") || endsWith(lower, ".tgz");
+}
+
+std::string Archive::normalize(const std::string &name)
+{
+    std::string n = std::filesystem::path(name).lexically_normal().generic_string();
+    while(n.size() >= 2 && n.compare(0, 2, "./") == 0)
+        n = n.substr(2);
+    while(!n.empty() && n[0] == '/')
+        n = n.substr(1);
+    while(!n.empty() && n.back() == '/')
+        n.pop_back();
+    return n == "." ? "" : n;
+}
+
+void Archive::addEntry(const std::string &name, uint64_t offset, uint64_t compressedSize, uint64_t size, int method)
+{
+    // skip members that would resolve outside of the archive root when
+    // extracted (absolute names, or names going up with ".."):
+    std::string n = normalize(name);
+    if(n.empty() || name[0] == '/' || name[0] == '\\' || n == ".." || n.compare(0, 3, "../") == 0) return;
+    entries[n] = Entry{offset, compressedSize, size, method};
+    for(size_t i = n.find('/'); i != std::string::npos; i = n.find('/', i + 1))
+        directories.insert(n.substr(0, i));
+}
+
+void Archive::indexZip()
+{
+    std::ifstream f(path_, std::ios::binary | std::ios::ate);
+    if(!f)
+        throw std::runtime_error("cannot read file " + path_);
+    uint64_t fileSize = f.tellg();
+
+    // the end of central directory record is at the end, before a comment of up to 64k:
+    uint64_t tailSize = std::min<uint64_t>(fileSize, 22 + 65535);
+    std::string tail(tailSize, '\0');
+    f.seekg(fileSize - tailSize);
+    f.read(&tail[0], tailSize);
+    size_t eocd = std::string::npos;
+    for(size_t i = tailSize - 22 + 1; i-- > 0;)
+        if(le32(&tail[i]) == 0x06054b50) { eocd = i; break; }
+    if(eocd == std::string::npos)
+        throw std::runtime_error("not a zip file: " + path_);
+    uint32_t count = le16(&tail[eocd + 10]);
+    uint32_t cdSize = le32(&tail[eocd + 12]);
+    uint32_t cdOffset = le32(&tail[eocd + 16]);
+    if(cdOffset == 0xffffffff || count == 0xffff)
+        throw std::runtime_error("zip64 archives are not supported: " + path_);
+
+    std::string cd(cdSize, '\0');
+    f.seekg(cdOffset);
+    f.read(&cd[0], cdSize);
+    if(!f)
+        throw std::runtime_error("corrupt zip file: " + path_);
+    size_t p = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(p + 46 > cd.size() || le32(&cd[p]) != 0x02014b50)
+            throw std::runtime_error("corrupt zip file: " + path_);
+        int method = le16(&cd[p + 10]);
+        uint32_t compressedSize = le32(&cd[p + 20]);
+        uint32_t size = le32(&cd[p + 24]);
+        uint32_t nameLen = le16(&cd[p + 28]), extraLen = le16(&cd[p + 30]), commentLen = le16(&cd[p + 32]);
+        uint32_t localOffset = le32(&cd[p + 42]);
+        std::string name = cd.substr(p + 46, nameLen);
+        // the offset of the data is resolved when reading, from the local header:
+        if(!name.empty() && name.back() != '/')
+            addEntry(name, localOffset, compressedSize, size, method);
+        else if(!name.empty())
+            directories.insert(normalize(name));
+        p += 46 + nameLen + extraLen + commentLen;
+    }
+}
+
+void Archive::indexTar(const std::string &data)
+{
+    std::string longName;
+    for(size_t p = 0; p + 512 <= data.size();)
+    {
+        const char *h = &data[p];
+        if(h[0] == '\0')
+            break; // end of archive
+        uint64_t size = octal(h + 124, 12);
+        char type = h[156];
+        std::string name = cstr(h, 100);
+        if(std::memcmp(h + 257, "ustar", 5) == 0 && h[345])
+            name = cstr(h + 345, 155) + "/" + name;
+        if(!longName.empty())
+        {
+            name = longName;
+            longName.clear();
+        }
+        uint64_t dataOffset = p + 512;
+        if(dataOffset + size > data.size())
+            throw std::runtime_error("truncated tar file: " + path_);
+        if(type == 'L')
+        {
+            // GNU long name of the next entry:
+            longName = cstr(&data[dataOffset], size);
+        }
+        else if(type == 'x')
+        {
+            // pax extended header; only the path is used:
+            std::string pax = data.substr(dataOffset, size);
+            for(size_t i = 0; i < pax.size();)
+            {
+                size_t sp = pax.find(' ', i);
+                if(sp == std::string::npos) break;
+                size_t len = std::stoul(pax.substr(i, sp - i));
+                if(len == 0) break;
+                std::string record = pax.substr(sp + 1, len - (sp - i) - 2);
+                if(record.compare(0, 5, "path=") == 0)
+                    longName = record.substr(5);
+                i += len;
+            }
+        }
+        else if(type == '0' || type == '\0' || type == '7')
+            addEntry(name, dataOffset, size, size, 0);
+        else if(type == '5')
+            directories.insert(normalize(name));
+        p = dataOffset + (size + 511) / 512 * 512;
+    }
+}
+
+bool Archive::exists(const std::string &name) const
+{
+    std::string n = normalize(name);
+    return entries.count(n) > 0 || directories.count(n) > 0;
+}
+
+bool Archive::isDirectory(const std::string &name) const
+{
+    return directories.count(normalize(name)) > 0;
+}
+
+std::string Archive::read(const std::string &name) const
+{
+    auto it = entries.find(normalize(name));
+    if(it == entries.end())
+        throw std::runtime_error("archive " + path_ + " has no member " + name);
+    const Entry &e = it->second;
+    if(!zip)
+        return tarData.substr(e.offset, e.size);
+
+    std::ifstream f(path_, std::ios::binary);
+    char lh[30];
+    f.seekg(e.offset);
+    f.read(lh, sizeof(lh));
+    if(!f || le32(lh) != 0x04034b50)
+        throw std::runtime_error("corrupt zip file: " + path_);
+    f.seekg(e.offset + 30 + le16(lh + 26) + le16(lh + 28));
+    std::string compressed(e.compressedSize, '\0');
+    f.read(&compressed[0], e.compressedSize);
+    if(!f)
+        throw std::runtime_error("corrupt zip file: " + path_);
+    if(e.method == 0)
+        return compressed;
+    if(e.method == 8)
+        return inflateData(compressed.data(), compressed.size(), -MAX_WBITS, e.size);
+    throw std::runtime_error("unsupported compression method in zip file " + path_);
+}
+
+std::vector<std::string> Archive::list(const std::string &prefix) const
+{
+    std::string p = normalize(prefix);
+    std::vector<std::string> names;
+    for(const auto &e : entries)
+        if(p.empty() || e.first.compare(0, p.size() + 1, p + "/") == 0)
+            names.push_back(e.first);
+    return names;
+}
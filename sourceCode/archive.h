@@ -0,0 +1,60 @@
+#ifndef SIMSDF_ARCHIVE_H_INCLUDED
+#define SIMSDF_ARCHIVE_H_INCLUDED
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// read-only access to the members of a .zip, .tar, or .tar.gz/.tgz archive,
+// without extracting it. The index of the members is built when opening;
+// members are decompressed into memory when read. zip members are read
+// from the file on demand; a gzipped tar is decompressed once, as it can't
+// be seeked. Reading is thread-safe.
+
+class Archive
+{
+public:
+    Archive(const std::string &path);
+
+    static bool isArchive(const std::string &path);
+
+    const std::string & path() const { return path_; }
+    bool exists(const std::string &name) const;
+    bool isDirectory(const std::string &name) const;
+    std::string read(const std::string &name) const;
+    // names of the files, optionally only those under directory prefix:
+    std::vector<std::string> list(const std::string &prefix = "") const;
+
+    // member names are relative, with '/' separators, without "." and ".."
+    // components, and without trailing '/' (members with absolute names or
+    // with leading ".." components are ignored when indexing):
+    static std::string normalize(const std::string &name);
+
+private:
+    void indexZip();
+    void indexTar(const std::string &data);
+    void addEntry(const std::string &name, uint64_t offset, uint64_t compressedSize, uint64_t size, int method);
+
+    struct Entry
+    {
+        uint64_t offset;
+        uint64_t compressedSize;
+        uint64_t size;
+        // 0: stored, 8: deflate (zip only)
+        int method;
+    };
+
+    std::string path_;
+    bool zip = false;
+    // contents of an uncompressed or gzipped tar:
+    std::string tarData;
+    std::map<std::string, Entry> entries;
+    std::set<std::string> directories;
+};
+
+bool isGzip(const std::string &data);
+std::string gunzip(const std::string &data);
+
+#endif // SIMSDF_ARCHIVE_H_INCLUDED
@@ -0,0 +1,201 @@
+#include "geometryStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+
+namespace
+{
+    const char magic[8] = {'S', 'D', 'F', 'G', 'E', 'O', 'M', 0};
+    const uint32_t version = 1;
+    const uint64_t alignment = 64;
+    // temporary files older than this are left over by crashed writers:
+    const auto staleTemporaryAge = std::chrono::hours(1);
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t verticesOffset;
+        uint64_t verticesSize;
+        uint64_t indicesOffset;
+        uint64_t indicesSize;
+    };
+
+    uint64_t align(uint64_t x)
+    {
+        return (x + alignment - 1) / alignment * alignment;
+    }
+}
+
+GeometryStore::Entry::Entry(const std::string &path)
+{
+    // an empty file can't be mapped, check the size first:
+    Header h;
+    if(std::filesystem::file_size(path) < sizeof(h))
+        throw BadEntry("truncated geometry file " + path);
+    // the mapping stays valid after the file handle is closed:
+    {
+        boost::interprocess::file_mapping file(path.c_str(), boost::interprocess::read_only);
+        boost::interprocess::mapped_region(file, boost::interprocess::read_only).swap(region);
+    }
+    const char *base = static_cast<const char*>(region.get_address());
+    if(region.get_size() < sizeof(h))
+        throw BadEntry("truncated geometry file " + path);
+    std::memcpy(&h, base, sizeof(h));
+    if(std::memcmp(h.magic, magic, sizeof(magic)) != 0 || h.version != version)
+        throw BadEntry("bad geometry file " + path);
+    if(h.verticesOffset + h.verticesSize * sizeof(float) > region.get_size()
+            || h.indicesOffset + h.indicesSize * sizeof(int32_t) > region.get_size())
+        throw BadEntry("truncated geometry file " + path);
+    vertices_ = reinterpret_cast<const float*>(base + h.verticesOffset);
+    verticesSize_ = h.verticesSize;
+    indices_ = reinterpret_cast<const int32_t*>(base + h.indicesOffset);
+    indicesSize_ = h.indicesSize;
+}
+
+GeometryStore::GeometryStore(const std::string &dir, uint64_t maxSize)
+    : dir(dir), maxSize(maxSize)
+{
+    std::filesystem::create_directories(dir);
+}
+
+std::string GeometryStore::path(const std::string &key) const
+{
+    return (std::filesystem::path(dir) / (key + ".geom")).string();
+}
+
+std::unique_ptr<GeometryStore::Entry> GeometryStore::find(const std::string &key)
+{
+    std::string p = path(key);
+    std::error_code ec;
+    if(!std::filesystem::exists(p, ec))
+        return nullptr;
+    std::unique_ptr<Entry> entry;
+    try
+    {
+        entry.reset(new Entry(p));
+    }
+    catch(BadEntry &ex)
+    {
+        // corrupted entry: drop it
+        std::filesystem::remove(p, ec);
+        return nullptr;
+    }
+    catch(std::exception &ex)
+    {
+        // I/O error (e.g. out of file descriptors, or a network filesystem
+        // hiccup): the entry may be fine, treat it as a miss
+        return nullptr;
+    }
+    // the modification time is used for LRU eviction:
+    std::filesystem::last_write_time(p, std::filesystem::file_time_type::clock::now(), ec);
+    return entry;
+}
+
+void GeometryStore::store(const std::string &key, const double *vertices, size_t verticesSize, const int *indices, size_t indicesSize)
+{
+    Header h;
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.version = version;
+    h.reserved = 0;
+    h.verticesOffset = align(sizeof(h));
+    h.verticesSize = verticesSize;
+    h.indicesOffset = align(h.verticesOffset + verticesSize * sizeof(float));
+    h.indicesSize = indicesSize;
+
+    std::vector<char> data(h.indicesOffset + indicesSize * sizeof(int32_t), 0);
+    std::memcpy(data.data(), &h, sizeof(h));
+    float *v = reinterpret_cast<float*>(data.data() + h.verticesOffset);
+    for(size_t i = 0; i < verticesSize; i++)
+        v[i] = float(vertices[i]);
+    int32_t *idx = reinterpret_cast<int32_t*>(data.data() + h.indicesOffset);
+    for(size_t i = 0; i < indicesSize; i++)
+        idx[i] = int32_t(indices[i]);
+
+    std::string p = path(key);
+    // a random suffix, as the directory may be shared by other machines:
+    std::string tmp = p + ".tmp-" + boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%").string();
+    {
+        std::ofstream f(tmp, std::ios::binary);
+        f.write(data.data(), data.size());
+        if(!f)
+        {
+            std::error_code ec;
+            std::filesystem::remove(tmp, ec);
+            throw std::runtime_error("failed to write " + tmp);
+        }
+    }
+    std::error_code ec;
+    bool replaced = std::filesystem::exists(p, ec);
+    std::filesystem::rename(tmp, p);
+
+    if(maxSize == 0)
+        return;
+    if(totalSize < 0)
+        totalSize = scan();
+    else if(!replaced)
+        totalSize += data.size();
+    if(uint64_t(totalSize) > maxSize)
+        evict();
+}
+
+std::vector<GeometryStore::File> GeometryStore::list()
+{
+    // entries, and temporary files being written; stale temporary files
+    // are removed:
+    std::vector<File> files;
+    auto now = std::filesystem::file_time_type::clock::now();
+    std::error_code ec;
+    for(const auto &e : std::filesystem::directory_iterator(dir, ec))
+    {
+        std::string name = e.path().filename().string();
+        bool temporary = name.find(".geom.tmp") != std::string::npos;
+        if(!temporary && e.path().extension() != ".geom") continue;
+        File file{e.path(), e.last_write_time(ec), e.file_size(ec), temporary};
+        if(ec) continue;
+        if(temporary && now - file.mtime > staleTemporaryAge)
+        {
+            std::filesystem::remove(file.path, ec);
+            continue;
+        }
+        files.push_back(file);
+    }
+    return files;
+}
+
+uint64_t GeometryStore::scan()
+{
+    uint64_t total = 0;
+    for(const File &file : list())
+        total += file.size;
+    return total;
+}
+
+void GeometryStore::evict()
+{
+    std::vector<File> files = list();
+    uint64_t total = 0;
+    for(const File &file : files)
+        total += file.size;
+    totalSize = total;
+    if(total <= maxSize)
+        return;
+
+    // temporary files are counted, but not evicted, as they may be in use:
+    std::sort(files.begin(), files.end(), [](const File &a, const File &b) { return a.mtime < b.mtime; });
+    std::error_code ec;
+    for(const File &file : files)
+    {
+        if(total <= maxSize) break;
+        if(file.temporary) continue;
+        if(std::filesystem::remove(file.path, ec))
+            total -= file.size;
+    }
+    totalSize = total;
+}
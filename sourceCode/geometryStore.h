@@ -0,0 +1,81 @@
+#ifndef SIMSDF_GEOMETRYSTORE_H_INCLUDED
+#define SIMSDF_GEOMETRYSTORE_H_INCLUDED
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/interprocess/mapped_region.hpp>
+
+// on-disk store of processed meshes, in a compact binary format (a header
+// followed by aligned float vertex and int32 index arrays), addressed by a
+// key computed by the caller from the source contents and processing
+// parameters. Entries are read back through mmap. When the store exceeds
+// its size cap, least recently used entries are evicted (the size of the
+// store is scanned once, then kept as a running total, and rescanned only
+// when over the cap, as other processes may have changed it). The directory can
+// be shared by several processes/machines: entries are written to uniquely
+// named temporary files, published with an atomic rename; temporary files
+// left over by crashed writers are removed when scanning.
+
+class GeometryStore
+{
+public:
+    // thrown by Entry when the file is not a valid entry (as opposed to
+    // I/O errors, which are reported as other exceptions):
+    class BadEntry : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // only the mapped region is kept, not the file handle:
+    class Entry
+    {
+    public:
+        Entry(const std::string &path);
+
+        const float * vertices() const { return vertices_; }
+        size_t verticesSize() const { return verticesSize_; }
+        const int32_t * indices() const { return indices_; }
+        size_t indicesSize() const { return indicesSize_; }
+
+    private:
+        boost::interprocess::mapped_region region;
+        const float *vertices_;
+        size_t verticesSize_;
+        const int32_t *indices_;
+        size_t indicesSize_;
+    };
+
+    GeometryStore(const std::string &dir, uint64_t maxSize);
+
+    // returns nullptr if the key is not in the store:
+    std::unique_ptr<Entry> find(const std::string &key);
+
+    void store(const std::string &key, const double *vertices, size_t verticesSize, const int *indices, size_t indicesSize);
+
+private:
+    struct File
+    {
+        std::filesystem::path path;
+        std::filesystem::file_time_type mtime;
+        uint64_t size;
+        bool temporary;
+    };
+
+    std::string path(const std::string &key) const;
+    std::vector<File> list();
+    uint64_t scan();
+    void evict();
+
+    std::string dir;
+    uint64_t maxSize;
+    // -1 until the directory is scanned:
+    int64_t totalSize = -1;
+};
+
+#endif // SIMSDF_GEOMETRYSTORE_H_INCLUDED
@@ -4,10 +4,21 @@
 #include <streambuf>
 #include <string>
 #include <vector>
+#include <array>
 #include <map>
+#include <unordered_map>
+#include <memory>
 #include <set>
 #include <algorithm>
 #include <filesystem>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <cstring>
+#include <cstdint>
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string.hpp>
@@ -18,6 +29,13 @@
 
 #include <simPlusPlus/Plugin.h>
 #include "config.h"
+#include "util.h"
+#include "geometryStore.h"
+#include "trace.h"
+#include "xmlFilter.h"
+#include "respondableMasks.h"
+#include "archive.h"
+#include "stlReader.h"
 #include "plugin.h"
 #include <gz/math/Pose3.hh>
 #include <gz/sdformat13/sdformat.hh>
@@ -62,6 +80,325 @@ using std::string;
     sim::setObjectProperty(obj, sim::getObjectProperty(obj) | sim_objectproperty_selectmodelbaseinstead); \
 }
 
+template<typename... Args>
+string formatMessage(const string &fmt, Args&&... args)
+{
+    boost::format f(fmt);
+    (void)(f % ... % args);
+    return f.str();
+}
+
+// debug messages are formatted (and their arguments evaluated) only if the
+// debug verbosity is enabled:
+#define DEBUG_LOG(ctx, ...) \
+do { if((ctx).debugLog) (ctx).log(sim_verbosity_debug, formatMessage(__VA_ARGS__)); } while(0)
+
+// a span of the import trace; likewise, the name is evaluated only if
+// tracing is enabled:
+#define TRACE_SPAN(ctx, category, name) \
+TraceSpan traceSpan((ctx).trace.get(), category, (ctx).trace ? string(name) : string())
+
+// bump allocator for the temporary buffers of an import; memory is
+// reused after a Scope ends, and freed when the arena is destroyed:
+
+class ImportArena
+{
+public:
+    ImportArena(size_t blockSize = 1 << 20) : blockSize(blockSize) {}
+
+    void * allocate(size_t size, size_t alignment)
+    {
+        for(; current < blocks.size(); current++)
+        {
+            Block &b = blocks[current];
+            size_t offset = (b.used + alignment - 1) & ~(alignment - 1);
+            if(offset + size <= b.size)
+            {
+                b.used = offset + size;
+                return b.data.get() + offset;
+            }
+        }
+        Block b;
+        b.size = std::max(blockSize, size + alignment);
+        b.data.reset(new char[b.size]);
+        b.used = size;
+        blocks.push_back(std::move(b));
+        current = blocks.size() - 1;
+        return blocks.back().data.get();
+    }
+
+    class Scope
+    {
+    public:
+        Scope(ImportArena &arena) : arena(arena), block(arena.current), used(arena.blocks.empty() ? 0 : arena.blocks[arena.current].used) {}
+        ~Scope()
+        {
+            for(size_t i = block + 1; i < arena.blocks.size(); i++)
+                arena.blocks[i].used = 0;
+            if(block < arena.blocks.size())
+                arena.blocks[block].used = used;
+            arena.current = block;
+        }
+
+    private:
+        ImportArena &arena;
+        size_t block;
+        size_t used;
+    };
+
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+        size_t used;
+    };
+    vector<Block> blocks;
+    size_t current = 0;
+    size_t blockSize;
+};
+
+template<typename T>
+struct ArenaAllocator
+{
+    typedef T value_type;
+    ArenaAllocator(ImportArena &arena) : arena(&arena) {}
+    template<typename U> ArenaAllocator(const ArenaAllocator<U> &o) : arena(o.arena) {}
+    T * allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T *p, size_t n) {}
+    template<typename U> bool operator==(const ArenaAllocator<U> &o) const { return arena == o.arena; }
+    template<typename U> bool operator!=(const ArenaAllocator<U> &o) const { return arena != o.arena; }
+    ImportArena *arena;
+};
+
+struct MeshData
+{
+    MeshData(ImportArena &arena) : vertices(arena), indices(arena) {}
+
+    vector<double, ArenaAllocator<double>> vertices;
+    vector<int, ArenaAllocator<int>> indices;
+
+    void append(const MeshData &m, const C7Vector &tr)
+    {
+        int offset = vertices.size() / 3;
+        for(int i = 0; i < m.vertices.size() / 3; i++)
+        {
+            C3Vector v(m.vertices.data() + 3 * i);
+            v = tr * v;
+            vertices.push_back(v(0));
+            vertices.push_back(v(1));
+            vertices.push_back(v(2));
+        }
+        for(int i : m.indices)
+            indices.push_back(offset + i);
+    }
+};
+
+struct TextureCacheEntry
+{
+    int textureId;
+    int planeHandle;
+};
+
+struct DecodedMesh
+{
+    vector<double> vertices;
+    vector<int> indices;
+};
+
+// state of one simSDF.import call; everything is freed when it finishes:
+
+struct ImportContext
+{
+    ImportContext(const ImportOptions &opts) : opts(opts) {}
+
+    ~ImportContext()
+    {
+        if(!tempDir.empty())
+        {
+            std::error_code ec;
+            std::filesystem::remove_all(tempDir, ec);
+        }
+    }
+
+    // log messages are held back while the context is used from a worker
+    // thread (the sim API must only be called from the main thread):
+    void log(int verbosity, const string &message)
+    {
+        if(deferLog)
+            deferredLog.push_back({verbosity, message});
+        else
+            sim::addLog(verbosity, "%s", message);
+    }
+
+    void flushLog()
+    {
+        deferLog = false;
+        for(const auto &x : deferredLog)
+            sim::addLog(x.first, "%s", x.second);
+        deferredLog.clear();
+    }
+
+    const ImportOptions &opts;
+    bool debugLog = false;
+    std::shared_ptr<TraceWriter> trace;
+    bool deferLog = false;
+    vector<std::pair<int, string>> deferredLog;
+    ImportStats stats;
+    ImportArena arena;
+    map<string, TextureCacheEntry> textureCache;
+    map<string, bool> textureCoordinates;
+    map<string, DecodedMesh> decodedMeshes;
+    set<string> resources;
+    vector<int> modelBases;
+    bool hasNestedModels = false;
+    std::shared_ptr<GeometryStore> geometryStore;
+    map<string, string> geometryKeys;
+    map<string, std::unique_ptr<GeometryStore::Entry>> mappedGeometry;
+    std::filesystem::path cacheEntryDir;
+    // when importing from an archive, opts.fileName is a virtual path
+    // starting with archivePrefix (the archive path followed by '/'):
+    std::shared_ptr<Archive> archive;
+    string archivePrefix;
+    // archive members extracted for APIs that only accept a file path:
+    std::filesystem::path tempDir;
+    map<string, string> extracted;
+};
+
+// handles and kinematic tree of a model, with links and joints
+// addressed by their index in the sdf::Model:
+
+struct ModelTables
+{
+    ModelTables(const sdf::Model *model)
+        : model(model),
+          linkHandles(model->LinkCount(), -1),
+          jointHandles(model->JointCount(), -1),
+          linkParentJoint(model->LinkCount(), -1),
+          jointParentLink(model->JointCount(), -1),
+          jointChildLink(model->JointCount(), -1),
+          childJointsOffset(model->LinkCount() + 1, 0)
+    {
+        std::unordered_map<string, int> linkIndex;
+        for(int i = 0; i < model->LinkCount(); i++)
+            linkIndex[model->LinkByIndex(i)->Name()] = i;
+        for(int j = 0; j < model->JointCount(); j++)
+        {
+            const sdf::Joint *joint = model->JointByIndex(j);
+            auto p = linkIndex.find(joint->ParentName());
+            if(p != linkIndex.end())
+            {
+                jointParentLink[j] = p->second;
+                childJointsOffset[p->second + 1]++;
+            }
+            auto c = linkIndex.find(joint->ChildName());
+            if(c != linkIndex.end())
+                linkParentJoint[c->second] = j;
+            jointChildLink[j] = c != linkIndex.end() ? c->second : -1;
+        }
+        for(int i = 0; i < model->LinkCount(); i++)
+            childJointsOffset[i + 1] += childJointsOffset[i];
+        childJoints.resize(childJointsOffset.back());
+        vector<int> fill(childJointsOffset.begin(), childJointsOffset.end() - 1);
+        for(int j = 0; j < model->JointCount(); j++)
+            if(jointParentLink[j] != -1)
+                childJoints[fill[jointParentLink[j]]++] = j;
+    }
+
+    const sdf::Model *model;
+    vector<int> linkHandles;
+    vector<int> jointHandles;
+    vector<int> linkParentJoint;
+    vector<int> jointParentLink;
+    vector<int> jointChildLink;
+    // child joints of link i are childJoints[childJointsOffset[i] .. childJointsOffset[i + 1] - 1]:
+    vector<int> childJointsOffset;
+    vector<int> childJoints;
+};
+
+// lidars are stored as a dummy with one or more vision sensors attached,
+// and a lookup table mapping each beam of the SDF scan to a depth pixel:
+
+struct LidarHeader
+{
+    int32_t version;
+    int32_t horizontalSamples;
+    int32_t verticalSamples;
+    int32_t sensorCount;
+    float rangeMin;
+    float rangeMax;
+};
+
+struct LidarBeam
+{
+    int32_t sensor;
+    int32_t pixel;
+    float scale;
+};
+
+struct LidarScanner
+{
+    LidarHeader header;
+    vector<LidarBeam> lut;
+    vector<int> sensorHandles;
+};
+
+// visual LODs are stored as sibling shapes of the full resolution visual;
+// the full resolution shape has a "sdfLod" block with a tag and the switch
+// distances, each simplified shape has a "sdfLodLevel" block with the same
+// tag and its level:
+
+struct LodGroup
+{
+    vector<int> levelHandles;
+    vector<double> distances;
+    int currentLevel = -1;
+};
+
+// actors are stored as a dummy (with the skin mesh attached) with a
+// "sdfActor" block holding their script compiled into segments, played one
+// after the other; in a segment the position is the cubic
+// ((a * s + b) * s + c) * s + d, with s = (t - t0) / duration, and the
+// orientation is the slerp from q0 to q1 (quaternions as x, y, z, w):
+
+struct ActorHeader
+{
+    int32_t version;
+    int32_t segmentCount;
+    int32_t loop;
+    int32_t autoStart;
+    double delayStart;
+    double duration;
+};
+
+struct ActorSegment
+{
+    double t0;
+    double invDuration;
+    double coeffs[4][3];
+    double q0[4];
+    double q1[4];
+    // 0 if q0 and q1 are too close for slerp (then nlerp is used):
+    double invSinAngle;
+    double angle;
+};
+
+// all the segments of the scene are kept in one array; tracks index it:
+
+struct ActorTrack
+{
+    int handle;
+    int firstSegment;
+    int segmentCount;
+    int cursor = 0;
+    bool loop;
+    double delayStart;
+    double duration;
+    // simulation time the script was started at (0 with auto_start), or
+    // -1 if not started yet:
+    double startTime;
+};
+
 class Plugin : public sim::Plugin
 {
 public:
@@ -74,78 +411,191 @@ public:
         setBuildDate(BUILD_DATE);
     }
 
-    set<const sdf::Joint*> getChildJoints(const sdf::Link *link, const sdf::Model *model)
+    void onInstanceSwitch(int sceneID)
+    {
+        lidars.clear();
+        lodGroups.clear();
+        lodGroupsDirty = true;
+        lodHandlesKnown = false;
+        actors.clear();
+        actorSegments.clear();
+        actorRestPoses.clear();
+        actorStartTimes.clear();
+        actorsDirty = true;
+        actorHandlesKnown = false;
+    }
+
+    void onInstancePass(const sim::InstancePassFlags &flags)
     {
-        set<const sdf::Joint*> ret;
-        for(int i = 0; i < model->JointCount(); i++)
+        // objects created by the importer are tracked as they are created;
+        // others (e.g. in a loaded model) are only found by a full scan:
+        if(flags.modelLoaded || flags.sceneLoaded || flags.undoCalled || flags.redoCalled)
+            lodHandlesKnown = actorHandlesKnown = false;
+        if(flags.objectsErased || !lodHandlesKnown || !actorHandlesKnown)
         {
-            const sdf::Joint *joint = model->JointByIndex(i);
-            if(joint->ParentName() == link->Name())
-                ret.insert(joint);
+            lodGroupsDirty = true;
+            actorsDirty = true;
         }
-        return ret;
+        updateLods();
+    }
+
+    void onModuleHandle(char *customData)
+    {
+        // called once per simulation step:
+        updateActors();
     }
 
-    const sdf::Joint * getParentJoint(const sdf::Link *link, const sdf::Model *model)
+    void onSimulationAboutToStart()
     {
-        for(int i = 0; i < model->JointCount(); i++)
+        actorStartTimes.clear();
+        scanActors();
+        actorRestPoses.clear();
+        for(const ActorTrack &a : actors)
         {
-            const sdf::Joint *joint = model->JointByIndex(i);
-            if(joint->ChildName() == link->Name())
-                return joint;
+            std::array<double, 7> pose;
+            simGetObjectPose(a.handle, sim_handle_parent, pose.data());
+            actorRestPoses[a.handle] = pose;
         }
-        return nullptr;
     }
 
-    const sdf::Link * getParentLink(const sdf::Joint *joint, const sdf::Model *model)
+    void onSimulationEnded()
+    {
+        for(const auto &x : actorRestPoses)
+            if(sim::isHandle(x.first))
+                simSetObjectPose(x.first, sim_handle_parent, x.second.data());
+        actorRestPoses.clear();
+        actorStartTimes.clear();
+        actorsDirty = true;
+    }
+
+    bool isInArchive(const ImportContext &ctx, const string &path)
+    {
+        return ctx.archive && boost::starts_with(path, ctx.archivePrefix);
+    }
+
+    bool resourceExists(const ImportContext &ctx, const string &path)
+    {
+        if(isInArchive(ctx, path))
+            return ctx.archive->exists(path.substr(ctx.archivePrefix.size()));
+        return boost::filesystem::exists(path);
+    }
+
+    string readResource(const ImportContext &ctx, const string &path)
     {
-        return model->LinkByName(joint->ParentName());
+        if(isInArchive(ctx, path))
+            return ctx.archive->read(path.substr(ctx.archivePrefix.size()));
+        return readFile(path);
     }
 
-    const sdf::Link * getChildLink(const sdf::Joint *joint, const sdf::Model *model)
+    // STL meshes (plain, gzipped, or inside an archive) are parsed by the
+    // plugin rather than by the sim API, as that can be done on worker
+    // threads:
+    bool isMemoryMesh(const string &path)
     {
-        return model->LinkByName(joint->ChildName());
+        string lower = boost::algorithm::to_lower_copy(path);
+        return boost::ends_with(lower, ".stl") || boost::ends_with(lower, ".stl.gz");
     }
 
-    void alternateRespondableMasks(int objHandle, bool bitSet = false)
+    // can run on a worker thread:
+    const DecodedMesh & decodeMesh(ImportContext &ctx, const string &filename)
     {
-        if(sim::getObjectType(objHandle) == sim_sceneobject_shape)
+        auto it = ctx.decodedMeshes.find(filename);
+        if(it != ctx.decodedMeshes.end())
+            return it->second;
+        TRACE_SPAN(ctx, "mesh", "decode " + filename);
+        string data = readResource(ctx, filename);
+        if(isGzip(data))
+            data = gunzip(data);
+        DecodedMesh mesh;
+        try
         {
-            int p = sim::getObjectInt32Param(objHandle, sim_shapeintparam_respondable);
-            if(p)
-            {
-                sim::setObjectInt32Param(objHandle, sim_shapeintparam_respondable_mask, bitSet ? 0xff01 : 0xff02);
-                bitSet = !bitSet;
-            }
+            readSTL(data, mesh.vertices, mesh.indices);
+        }
+        catch(std::exception &ex)
+        {
+            throw sim::exception("failed to load mesh '%s': %s", filename, ex.what());
+        }
+        return ctx.decodedMeshes[filename] = std::move(mesh);
+    }
+
+    // path of a file that can be passed to the sim API: archive members
+    // (and their content, for directories) are extracted to a temporary
+    // directory, and gzipped files are decompressed:
+    string getLocalPath(ImportContext &ctx, const string &path)
+    {
+        bool gz = boost::ends_with(boost::algorithm::to_lower_copy(path), ".gz");
+        if(!isInArchive(ctx, path) && !gz)
+            return path;
+        auto it = ctx.extracted.find(path);
+        if(it != ctx.extracted.end())
+            return it->second;
+
+        if(ctx.tempDir.empty())
+        {
+            // a new directory (create_directory fails if it exists), so that
+            // removing it can't affect other imports or processes:
+            std::filesystem::path dir;
+            do dir = std::filesystem::temp_directory_path() / boost::filesystem::unique_path("simSDF-%%%%-%%%%-%%%%-%%%%").string();
+            while(!std::filesystem::create_directory(dir));
+            ctx.tempDir = dir;
+        }
+        // archive members keep their relative path; other gzipped files go
+        // in a directory named after a hash of their full path, so that files
+        // with the same name in different directories don't collide:
+        string name = isInArchive(ctx, path)
+            ? Archive::normalize(path.substr(ctx.archivePrefix.size()))
+            : Hash().add(path).hex() + "/" + std::filesystem::path(path).filename().string();
+        std::filesystem::path localPath = ctx.tempDir / name;
+        if(gz)
+            localPath.replace_extension();
+        auto write = [&] (const std::filesystem::path &p, const string &data)
+        {
+            // never write outside of the temporary directory:
+            std::filesystem::path rel = p.lexically_normal().lexically_relative(ctx.tempDir.lexically_normal());
+            if(rel.empty() || rel.is_absolute() || *rel.begin() == "..")
+                throw sim::exception("refusing to extract %s outside of %s", p.string(), ctx.tempDir.string());
+            std::filesystem::create_directories(p.parent_path());
+            std::ofstream f(p, std::ios::binary);
+            f << data;
+            if(!f)
+                throw sim::exception("failed to write %s", p.string());
+        };
+        if(isInArchive(ctx, path) && ctx.archive->isDirectory(name))
+        {
+            for(const string &member : ctx.archive->list(name))
+                write(ctx.tempDir / member, ctx.archive->read(member));
         }
-        for(int childHandle : sim::getObjectChildren(objHandle))
+        else
         {
-            alternateRespondableMasks(childHandle, bitSet);
+            string data = readResource(ctx, path);
+            write(localPath, gz && isGzip(data) ? gunzip(data) : data);
         }
+        DEBUG_LOG(ctx, "extracted %s to %s", path, localPath.string());
+        return ctx.extracted[path] = localPath.string();
     }
 
-    string getFileResourceFullPath(string path, string sdfFile, const sdf::Model *model)
+    string getFileResourceFullPath(ImportContext &ctx, string path, string sdfFile, const sdf::Model *model)
     {
         string sdfDir = sdfFile.substr(0, sdfFile.find_last_of('/'));
-        sim::addLog(sim_verbosity_debug, "sdfDir=" + sdfDir);
+        DEBUG_LOG(ctx, "sdfDir=%s", sdfDir);
 
-        if(boost::filesystem::exists(sdfDir + "/" + path))
+        if(resourceExists(ctx, sdfDir + "/" + path))
             return sdfDir + "/" + path;
-        else if(boost::filesystem::exists(path))
+        else if(resourceExists(ctx, path))
             return path;
         else
             throw sim::exception("could not determine the filesystem location of URI file://%s", path);
     }
 
-    string getModelResourceFullPath(string path, string sdfFile, const sdf::Model *model)
+    string getModelResourceFullPath(ImportContext &ctx, string path, string sdfFile, const sdf::Model *model)
     {
         string sdfDir = sdfFile.substr(0, sdfFile.find_last_of('/'));
         string sdfDirName = sdfDir.substr(sdfDir.find_last_of('/') + 1);
-        sim::addLog(sim_verbosity_debug, "sdfDir=" + sdfDir + ", sdfDirName=" + sdfDirName);
+        DEBUG_LOG(ctx, "sdfDir=%s, sdfDirName=%s", sdfDir, sdfDirName);
 
         string uriRoot = path.substr(0, path.find_first_of('/'));
         string uriRest = path.substr(path.find_first_of('/'));
-        sim::addLog(sim_verbosity_debug, "uriRoot=" + uriRoot + ", uriRest=" + uriRest);
+        DEBUG_LOG(ctx, "uriRoot=%s, uriRest=%s", uriRoot, uriRest);
 
         if(
                 uriRoot == model->Name()
@@ -156,21 +606,21 @@ public:
         )
         {
             string fullPath = sdfDir + uriRest;
-            sim::addLog(sim_verbosity_debug, "fullPath=" + fullPath);
+            DEBUG_LOG(ctx, "fullPath=%s", fullPath);
             return fullPath;
         }
         else
         {
             // try to match one level upper
             string sdfDirParent = sdfDir.substr(0, sdfDir.find_last_of('/'));
-            sim::addLog(sim_verbosity_debug, "sdfDirParent=" + sdfDirParent);
+            DEBUG_LOG(ctx, "sdfDirParent=%s", sdfDirParent);
             string fullPath = sdfDirParent + "/" + path;
-            sim::addLog(sim_verbosity_debug, "fullPath=" + fullPath);
-            if(boost::filesystem::exists(fullPath))
+            DEBUG_LOG(ctx, "fullPath=%s", fullPath);
+            if(resourceExists(ctx, fullPath))
                 return fullPath;
             else try
                 {
-                    return getFileResourceFullPath(path, sdfFile, model);
+                    return getFileResourceFullPath(ctx, path, sdfFile, model);
                 }
                 catch(...)
                 {
@@ -179,33 +629,97 @@ public:
         }
     }
 
-    string getResourceFullPath(string uri, string sdfFile, const sdf::Model *model)
+    string getResourceFullPath(ImportContext &ctx, string uri, string sdfFile, const sdf::Model *model)
+    {
+        string path = resolveResourceFullPath(ctx, uri, sdfFile, model);
+        // members of an archive are tracked through the archive itself:
+        bool added = ctx.resources.insert(isInArchive(ctx, path) ? ctx.archive->path() : path).second;
+        if(added && ctx.opts.cacheDir && !isInArchive(ctx, path))
+            trackMeshDependencies(ctx, path);
+        return path;
+    }
+
+    // for cache invalidation, track the files the sim API loads along with
+    // a mesh, which the plugin doesn't read itself: the materials of an OBJ
+    // file and their textures, and the images of a DAE file (only existing
+    // files are tracked):
+    void trackMeshDependencies(ImportContext &ctx, const string &path)
+    {
+        string lower = boost::algorithm::to_lower_copy(path);
+        auto track = [&] (const std::filesystem::path &dir, string name)
+        {
+            boost::algorithm::trim(name);
+            if(boost::starts_with(name, "file://"))
+                name = name.substr(7);
+            std::filesystem::path p = dir / name;
+            std::error_code ec;
+            if(name.empty() || !std::filesystem::is_regular_file(p, ec))
+                return false;
+            ctx.resources.insert(p.string());
+            return true;
+        };
+        std::filesystem::path dir = std::filesystem::path(path).parent_path();
+        if(boost::ends_with(lower, ".obj"))
+        {
+            std::istringstream obj(readFile(path));
+            for(string line; std::getline(obj, line);)
+            {
+                if(!boost::starts_with(line, "mtllib ") || !track(dir, line.substr(7)))
+                    continue;
+                std::filesystem::path mtlPath = dir / boost::algorithm::trim_copy(line.substr(7));
+                std::istringstream mtl(readFile(mtlPath.string()));
+                for(string mtlLine; std::getline(mtl, mtlLine);)
+                {
+                    // texture maps (map_Kd, map_Bump, bump, ...), with the
+                    // file name last, after the options:
+                    boost::algorithm::trim(mtlLine);
+                    if(!boost::starts_with(mtlLine, "map_") && !boost::starts_with(mtlLine, "bump ") && !boost::starts_with(mtlLine, "disp ") && !boost::starts_with(mtlLine, "decal "))
+                        continue;
+                    track(mtlPath.parent_path(), mtlLine.substr(mtlLine.find_last_of(" \t") + 1));
+                }
+            }
+        }
+        else if(boost::ends_with(lower, ".dae"))
+        {
+            string dae = readFile(path);
+            const string open = "<init_from>", close = "</init_from>";
+            for(size_t i = dae.find(open); i != string::npos; i = dae.find(open, i))
+            {
+                i += open.size();
+                size_t j = dae.find(close, i);
+                if(j == string::npos) break;
+                track(dir, dae.substr(i, j - i));
+            }
+        }
+    }
+
+    string resolveResourceFullPath(ImportContext &ctx, string uri, string sdfFile, const sdf::Model *model)
     {
         const string modelScheme = "model://";
         const string fileScheme = "file://";
         if(boost::starts_with(uri, modelScheme))
         {
-            return getModelResourceFullPath(uri.substr(modelScheme.size()), sdfFile, model);
+            return getModelResourceFullPath(ctx, uri.substr(modelScheme.size()), sdfFile, model);
         }
         else if(boost::starts_with(uri, fileScheme))
         {
-            return getFileResourceFullPath(uri.substr(fileScheme.size()), sdfFile, model);
+            return getFileResourceFullPath(ctx, uri.substr(fileScheme.size()), sdfFile, model);
         }
         else if(uri[0] == '/') // try to interpret as an absolute path
         {
-            sim::addLog(sim_verbosity_warnings, "URI \"%s\" does not have a scheme; assuming %s%s", uri, fileScheme, uri);
-            return getFileResourceFullPath(uri, sdfFile, model);
+            ctx.log(sim_verbosity_warnings, formatMessage("URI \"%s\" does not have a scheme; assuming %s%s", uri, fileScheme, uri));
+            return getFileResourceFullPath(ctx, uri, sdfFile, model);
         }
         else // try to interpret as a model-relative path
         {
-            sim::addLog(sim_verbosity_warnings, "URI \"%s\" does not have a scheme; assuming %s%s/%s", uri, modelScheme, model->Name(), uri);
-            return getModelResourceFullPath(model->Name() + "/" + uri, sdfFile, model);
+            ctx.log(sim_verbosity_warnings, formatMessage("URI \"%s\" does not have a scheme; assuming %s%s/%s", uri, modelScheme, model->Name(), uri));
+            return getModelResourceFullPath(ctx, model->Name() + "/" + uri, sdfFile, model);
         }
         //else
         //    throw sim::exception("URI '%s' does not start with '%s' or '%s'", uri, modelScheme, fileScheme);
     }
 
-    void setSimObjectName(const ImportOptions &opts, int objectHandle, string desiredName)
+    void setSimObjectName(ImportContext &ctx, int objectHandle, string desiredName)
     {
         // Objects in CoppeliaSim can only contain a-z, A-Z, 0-9, '_' or exaclty one '#' optionally followed by a number
         string baseName(desiredName);
@@ -274,7 +788,7 @@ public:
         return newShapeHandle;
     }
 
-    C7Vector getPose(const ImportOptions &opts, const gz::math::Pose3d& pose)
+    C7Vector getPose(ImportContext &ctx, const gz::math::Pose3d& pose)
     {
         C7Vector v;
         v.setIdentity();
@@ -290,18 +804,20 @@ public:
         return v;
     }
 
-    void importWorld(const ImportOptions &opts, const sdf::World *world)
+    void importWorld(ImportContext &ctx, const sdf::World *world)
     {
-        sim::addLog(sim_verbosity_debug, "Importing world '" + world->Name() + "'...");
-        sim::addLog(sim_verbosity_errors, "Importing worlds not implemented yet");
+        DEBUG_LOG(ctx, "Importing world '%s'...", world->Name());
+        for(int i = 0; i < world->ActorCount(); i++)
+            importActor(ctx, world->ActorByIndex(i));
+        sim::addLog(sim_verbosity_errors, "Importing worlds not implemented yet (only the actors of the world are imported)");
     }
 
-    int importEmptyGeometry(const ImportOptions &opts, const sdf::Model *model, bool static_, bool respondable, double mass)
+    int importEmptyGeometry(ImportContext &ctx, const sdf::Model *model, bool static_, bool respondable, double mass)
     {
         return sim::createDummy(0);
     }
 
-    int importBoxGeometry(const ImportOptions &opts, const sdf::Model *model, const sdf::Box *box, bool static_, bool respondable, double mass)
+    int importBoxGeometry(ImportContext &ctx, const sdf::Model *model, const sdf::Box *box, bool static_, bool respondable, double mass)
     {
         double sizes[3] = {box->Size().X(), box->Size().Y(), box->Size().Z()};
         int retVal = sim::createPrimitiveShape(sim_primitiveshape_cuboid, sizes, 1);
@@ -313,7 +829,7 @@ public:
         return retVal;
     }
 
-    int importSphereGeometry(const ImportOptions &opts, const sdf::Model *model, const sdf::Sphere *sphere, bool static_, bool respondable, double mass)
+    int importSphereGeometry(ImportContext &ctx, const sdf::Model *model, const sdf::Sphere *sphere, bool static_, bool respondable, double mass)
     {
         double sizes[3];
         sizes[0] = sizes[1] = sizes[2] = 2 * sphere->Radius();
@@ -326,7 +842,7 @@ public:
         return retVal;
     }
 
-    int importCylinderGeometry(const ImportOptions &opts, const sdf::Model *model, const sdf::Cylinder *cylinder, bool static_, bool respondable, double mass)
+    int importCylinderGeometry(ImportContext &ctx, const sdf::Model *model, const sdf::Cylinder *cylinder, bool static_, bool respondable, double mass)
     {
         double sizes[3];
         sizes[0] = sizes[1] = 2 * cylinder->Radius();
@@ -340,7 +856,7 @@ public:
         return retVal;
     }
 
-    int importHeightmapGeometry(const ImportOptions &opts, const sdf::Model *model, const sdf::Heightmap *heightmap, bool static_, bool respondable, double mass)
+    int importHeightmapGeometry(ImportContext &ctx, const sdf::Model *model, const sdf::Heightmap *heightmap, bool static_, bool respondable, double mass)
     {
         int options = 0
             + 1 // backface culling
@@ -355,14 +871,65 @@ public:
         return sim::createHeightfieldShape(options, shadingAngle, xPointCount, yPointCount, xSize, heights);
     }
 
-    int importMeshGeometry(const ImportOptions &opts, const sdf::Model *model, const sdf::Mesh *mesh, bool static_, bool respondable, double mass)
+    string getGeometryKey(ImportContext &ctx, const string &filename, const double scalingFactors[3])
+    {
+        string id = (boost::format("%s|%g|%g|%g") % filename % scalingFactors[0] % scalingFactors[1] % scalingFactors[2]).str();
+        auto it = ctx.geometryKeys.find(id);
+        if(it != ctx.geometryKeys.end())
+            return it->second;
+        Sha256 h;
+        h.add(readResource(ctx, filename));
+        for(int i = 0; i < 3; i++)
+            h.add(scalingFactors[i]);
+        return ctx.geometryKeys[id] = h.hex();
+    }
+
+    bool loadStoredMesh(ImportContext &ctx, const string &key, MeshData &mesh)
+    {
+        std::unique_ptr<GeometryStore::Entry> entry;
+        auto it = ctx.mappedGeometry.find(key);
+        if(it != ctx.mappedGeometry.end())
+        {
+            // already mapped by prefetchMeshes:
+            entry = std::move(it->second);
+            ctx.mappedGeometry.erase(it);
+        }
+        else
+        {
+            entry = ctx.geometryStore->find(key);
+        }
+        if(!entry)
+        {
+            ctx.stats.geometryStoreMisses++;
+            return false;
+        }
+        ctx.stats.geometryStoreHits++;
+        mesh.vertices.assign(entry->vertices(), entry->vertices() + entry->verticesSize());
+        mesh.indices.assign(entry->indices(), entry->indices() + entry->indicesSize());
+        return true;
+    }
+
+    void storeMesh(ImportContext &ctx, const string &key, const double *vertices, int verticesSize, const int *indices, int indicesSize)
     {
+        try
+        {
+            ctx.geometryStore->store(key, vertices, verticesSize, indices, indicesSize);
+        }
+        catch(std::exception &ex)
+        {
+            sim::addLog(sim_verbosity_warnings, "failed to add mesh to the geometry store: %s", ex.what());
+        }
+    }
+
+    int importMeshGeometry(ImportContext &ctx, const sdf::Model *model, const sdf::Mesh *mesh, bool static_, bool respondable, double mass)
+    {
+        TRACE_SPAN(ctx, "mesh", mesh->Uri());
         if(mesh->Submesh() != "")
             throw sim::exception("submesh loading is not supported");
-        if(!opts.fileName)
+        if(!ctx.opts.fileName)
             throw sim::exception("field 'fileName' must be set to the path of the SDF file");
-        string filename = getResourceFullPath(mesh->Uri(), *opts.fileName, model);
-        if(!sim::doesFileExist(filename))
+        string filename = getResourceFullPath(ctx, mesh->Uri(), *ctx.opts.fileName, model);
+        if(!resourceExists(ctx, filename))
             throw sim::exception("mesh '%s' does not exist", filename);
         string extension = filename.substr(filename.size() - 3, filename.size());
         boost::algorithm::to_lower(extension);
@@ -375,38 +942,295 @@ public:
         else if(extension == "dae") extensionNum = 5;
         else throw sim::exception("the mesh extension '%s' is not currently supported", extension);
         */
-        int handle = sim::importShape(filename, 16+128, 1.0f);
         double scalingFactors[3] = {mesh->Scale().X(), mesh->Scale().Y(), mesh->Scale().Z()};
-        if(fabs(1 - scalingFactors[0]) > 1e-6 || fabs(1 - scalingFactors[1]) > 1e-6 || fabs(1 - scalingFactors[2]) > 1e-6)
-            handle = scaleShape(handle, scalingFactors);
+        int handle = -1;
+        if(ctx.geometryStore || isMemoryMesh(filename))
+        {
+            // same path as getGeometryMesh, so that the geometry store has
+            // only one producer per key (shapes are created from vertices
+            // and indices, so don't keep the colors of the mesh file):
+            ImportArena::Scope scope(ctx.arena);
+            MeshData m(ctx.arena);
+            loadProcessedMesh(ctx, filename, scalingFactors, m);
+            handle = sim::createMeshShape(0, 20.0f * piValue / 180.0f, m.vertices.data(), m.vertices.size(), m.indices.data(), m.indices.size());
+        }
+        else
+        {
+            handle = sim::importShape(getLocalPath(ctx, filename), 16+128, 1.0f);
+            if(fabs(1 - scalingFactors[0]) > 1e-6 || fabs(1 - scalingFactors[1]) > 1e-6 || fabs(1 - scalingFactors[2]) > 1e-6)
+                handle = scaleShape(handle, scalingFactors);
+        }
         // edges can make things very ugly if the mesh is not nice:
         sim::setObjectInt32Param(handle, sim_shapeintparam_edge_visibility, 0);
         return handle;
     }
 
-    int importGeometry(const ImportOptions &opts, const sdf::Model *model, const sdf::Geometry *geometry, bool static_, bool respondable, double mass)
+    // load a mesh file and scale it, going through the geometry store if
+    // enabled:
+    void loadProcessedMesh(ImportContext &ctx, const string &filename, double scalingFactors[3], MeshData &mesh)
+    {
+        string geometryKey;
+        if(ctx.geometryStore)
+        {
+            geometryKey = getGeometryKey(ctx, filename, scalingFactors);
+            if(loadStoredMesh(ctx, geometryKey, mesh))
+                return;
+        }
+        loadMeshFile(ctx, filename, mesh);
+        if(fabs(1 - scalingFactors[0]) > 1e-6 || fabs(1 - scalingFactors[1]) > 1e-6 || fabs(1 - scalingFactors[2]) > 1e-6)
+            scaleMesh(mesh, scalingFactors);
+        if(ctx.geometryStore)
+            storeMesh(ctx, geometryKey, mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+    }
+
+    void scaleMesh(MeshData &mesh, double scalingFactors[3])
+    {
+        for(int i = 0; i < mesh.vertices.size(); i++)
+            mesh.vertices[i] *= scalingFactors[i % 3];
+        // Flip the triangles (if needed)
+        if(scalingFactors[0] * scalingFactors[1] * scalingFactors[2] < 0.0f)
+        {
+            for(int i = 0; i < mesh.indices.size() / 3; i++)
+                std::swap(mesh.indices[3 * i + 0], mesh.indices[3 * i + 1]);
+        }
+    }
+
+    void loadMeshFile(ImportContext &ctx, const string &filename, MeshData &mesh)
+    {
+        TRACE_SPAN(ctx, "sim", "importMesh " + filename);
+        if(isMemoryMesh(filename))
+        {
+            const DecodedMesh &decoded = decodeMesh(ctx, filename);
+            MeshData part(ctx.arena);
+            part.vertices.assign(decoded.vertices.begin(), decoded.vertices.end());
+            part.indices.assign(decoded.indices.begin(), decoded.indices.end());
+            C7Vector identity;
+            identity.setIdentity();
+            mesh.append(part, identity);
+            return;
+        }
+        double **vertices;
+        int *verticesSizes;
+        int **indices;
+        int *indicesSizes;
+        int count = simImportMesh(0 /* auto-detect */, getLocalPath(ctx, filename).c_str(), 128, 0.0001, 1.0, &vertices, &verticesSizes, &indices, &indicesSizes, nullptr, nullptr);
+        if(count <= 0)
+            throw sim::exception("failed to load mesh '%s'", filename);
+        MeshData part(ctx.arena);
+        C7Vector identity;
+        identity.setIdentity();
+        for(int i = 0; i < count; i++)
+        {
+            part.vertices.assign(vertices[i], vertices[i] + verticesSizes[i]);
+            part.indices.assign(indices[i], indices[i] + indicesSizes[i]);
+            mesh.append(part, identity);
+            simReleaseBuffer(vertices[i]);
+            simReleaseBuffer(indices[i]);
+        }
+        simReleaseBuffer(vertices);
+        simReleaseBuffer(verticesSizes);
+        simReleaseBuffer(indices);
+        simReleaseBuffer(indicesSizes);
+    }
+
+    void boxMesh(const sdf::Box *box, MeshData &mesh)
+    {
+        double hx = box->Size().X() / 2, hy = box->Size().Y() / 2, hz = box->Size().Z() / 2;
+        for(int i = 0; i < 8; i++)
+        {
+            mesh.vertices.push_back(i & 1 ? hx : -hx);
+            mesh.vertices.push_back(i & 2 ? hy : -hy);
+            mesh.vertices.push_back(i & 4 ? hz : -hz);
+        }
+        mesh.indices = {
+            0, 2, 1,  1, 2, 3, // -z
+            4, 5, 6,  5, 7, 6, // +z
+            0, 1, 4,  1, 5, 4, // -y
+            2, 6, 3,  3, 6, 7, // +y
+            0, 4, 2,  2, 4, 6, // -x
+            1, 3, 5,  3, 7, 5  // +x
+        };
+    }
+
+    void sphereMesh(const sdf::Sphere *sphere, MeshData &mesh, int slices = 24, int stacks = 12)
+    {
+        double r = sphere->Radius();
+        for(int j = 0; j <= stacks; j++)
+        {
+            double phi = piValue * j / stacks;
+            for(int i = 0; i < slices; i++)
+            {
+                double theta = 2 * piValue * i / slices;
+                mesh.vertices.push_back(r * sin(phi) * cos(theta));
+                mesh.vertices.push_back(r * sin(phi) * sin(theta));
+                mesh.vertices.push_back(r * cos(phi));
+            }
+        }
+        for(int j = 0; j < stacks; j++)
+        {
+            for(int i = 0; i < slices; i++)
+            {
+                int a = j * slices + i, b = j * slices + (i + 1) % slices;
+                int c = a + slices, d = b + slices;
+                if(j > 0)
+                    mesh.indices.insert(mesh.indices.end(), {a, c, b});
+                if(j < stacks - 1)
+                    mesh.indices.insert(mesh.indices.end(), {b, c, d});
+            }
+        }
+    }
+
+    void cylinderMesh(const sdf::Cylinder *cylinder, MeshData &mesh, int slices = 24)
+    {
+        double r = cylinder->Radius(), h = cylinder->Length() / 2;
+        for(int i = 0; i < slices; i++)
+        {
+            double theta = 2 * piValue * i / slices;
+            mesh.vertices.insert(mesh.vertices.end(), {r * cos(theta), r * sin(theta), -h});
+            mesh.vertices.insert(mesh.vertices.end(), {r * cos(theta), r * sin(theta), h});
+        }
+        int bottom = 2 * slices, top = 2 * slices + 1;
+        mesh.vertices.insert(mesh.vertices.end(), {0, 0, -h, 0, 0, h});
+        for(int i = 0; i < slices; i++)
+        {
+            int a = 2 * i, b = 2 * ((i + 1) % slices);
+            mesh.indices.insert(mesh.indices.end(), {a, b, a + 1,  b, b + 1, a + 1});
+            mesh.indices.insert(mesh.indices.end(), {bottom, b, a,  top, a + 1, b + 1});
+        }
+    }
+
+    bool getGeometryMesh(ImportContext &ctx, const sdf::Model *model, const sdf::Geometry *geometry, MeshData &mesh)
+    {
+        if(geometry->Type() == sdf::GeometryType::BOX)
+            boxMesh(geometry->BoxShape(), mesh);
+        else if(geometry->Type() == sdf::GeometryType::SPHERE)
+            sphereMesh(geometry->SphereShape(), mesh);
+        else if(geometry->Type() == sdf::GeometryType::CYLINDER)
+            cylinderMesh(geometry->CylinderShape(), mesh);
+        else if(geometry->Type() == sdf::GeometryType::MESH)
+        {
+            const sdf::Mesh *m = geometry->MeshShape();
+            if(m->Submesh() != "")
+                throw sim::exception("submesh loading is not supported");
+            if(!ctx.opts.fileName)
+                throw sim::exception("field 'fileName' must be set to the path of the SDF file");
+            string filename = getResourceFullPath(ctx, m->Uri(), *ctx.opts.fileName, model);
+            if(!resourceExists(ctx, filename))
+                throw sim::exception("mesh '%s' does not exist", filename);
+            double scalingFactors[3] = {m->Scale().X(), m->Scale().Y(), m->Scale().Z()};
+            loadProcessedMesh(ctx, filename, scalingFactors, mesh);
+        }
+        else
+            return false;
+        return true;
+    }
+
+    // whether the appearance of a visual is fully defined by its SDF
+    // material: true for primitives and STL meshes, false for meshes whose
+    // file can carry colors, textures and texture coordinates (DAE, OBJ...),
+    // which would be lost when merged:
+    bool hasSDFAppearance(ImportContext &ctx, const sdf::Model *model, const sdf::Geometry *geometry)
+    {
+        if(geometry->Type() != sdf::GeometryType::MESH)
+            return true;
+        if(!ctx.opts.fileName)
+            throw sim::exception("field 'fileName' must be set to the path of the SDF file");
+        return isMemoryMesh(getResourceFullPath(ctx, geometry->MeshShape()->Uri(), *ctx.opts.fileName, model));
+    }
+
+    string getMaterialKey(const sdf::Material *material)
+    {
+        if(!material)
+            return "";
+        std::stringstream ss;
+        auto c = [&](const gz::math::Color &x) { ss << x.R() << "," << x.G() << "," << x.B() << "," << x.A() << ";"; };
+        c(material->Ambient());
+        c(material->Diffuse());
+        c(material->Specular());
+        c(material->Emissive());
+        if(material->PbrMaterial())
+        {
+            const sdf::PbrWorkflow *w = material->PbrMaterial()->Workflow(sdf::PbrWorkflowType::METAL);
+            if(!w) w = material->PbrMaterial()->Workflow(sdf::PbrWorkflowType::SPECULAR);
+            if(w) ss << w->AlbedoMap();
+        }
+        return ss.str();
+    }
+
+    // checks shared by the importer and the validate command:
+
+    void checkGeometry(const sdf::Geometry *geometry)
+    {
+        switch(geometry->Type())
+        {
+        case sdf::GeometryType::EMPTY:
+        case sdf::GeometryType::BOX:
+        case sdf::GeometryType::SPHERE:
+        case sdf::GeometryType::CYLINDER:
+        case sdf::GeometryType::HEIGHTMAP:
+            break;
+        case sdf::GeometryType::MESH:
+            if(geometry->MeshShape()->Submesh() != "")
+                throw sim::exception("submesh loading is not supported");
+            break;
+        default:
+            throw sim::exception("the geometry type \"%s\" is not currently supported", geometry->Element()->GetAttribute("type")->GetAsString());
+        }
+    }
+
+    void checkSensor(const sdf::Sensor *sensor)
+    {
+        if(sensor->Type() != sdf::SensorType::CAMERA
+                && sensor->Type() != sdf::SensorType::LIDAR
+                && sensor->Type() != sdf::SensorType::GPU_LIDAR)
+            throw sim::exception("the sensor type \"%s\" is not currently supported", sensor->Element()->GetAttribute("type")->GetAsString());
+    }
+
+    void checkJoint(const sdf::Joint *joint)
+    {
+        if(!joint->Axis())
+            throw sim::exception("joint must have an axis");
+        if(joint->Axis()->XyzExpressedIn() != "")
+            throw sim::exception("joint axis expressed in frame \"%s\" is not supported", joint->Axis()->XyzExpressedIn());
+        switch(joint->Type())
+        {
+        case sdf::JointType::REVOLUTE:
+        case sdf::JointType::CONTINUOUS:
+        case sdf::JointType::PRISMATIC:
+        case sdf::JointType::SCREW:
+        case sdf::JointType::BALL:
+        case sdf::JointType::FIXED:
+            break;
+        default:
+            throw sim::exception("joint type \"%s\" is not supported", joint->Element()->GetAttribute("type")->GetAsString());
+        }
+    }
+
+    int importGeometry(ImportContext &ctx, const sdf::Model *model, const sdf::Geometry *geometry, bool static_, bool respondable, double mass)
     {
         int handle = -1;
 
+        checkGeometry(geometry);
+
         if(geometry->Type() == sdf::GeometryType::EMPTY)
-            return importEmptyGeometry(opts, model, static_, respondable, mass);
+            return importEmptyGeometry(ctx, model, static_, respondable, mass);
         else if(geometry->Type() == sdf::GeometryType::BOX)
-            return importBoxGeometry(opts, model, geometry->BoxShape(), static_, respondable, mass);
+            return importBoxGeometry(ctx, model, geometry->BoxShape(), static_, respondable, mass);
         else if(geometry->Type() == sdf::GeometryType::SPHERE)
-            return importSphereGeometry(opts, model, geometry->SphereShape(), static_, respondable, mass);
+            return importSphereGeometry(ctx, model, geometry->SphereShape(), static_, respondable, mass);
         else if(geometry->Type() == sdf::GeometryType::CYLINDER)
-            return importCylinderGeometry(opts, model, geometry->CylinderShape(), static_, respondable, mass);
+            return importCylinderGeometry(ctx, model, geometry->CylinderShape(), static_, respondable, mass);
         else if(geometry->Type() == sdf::GeometryType::HEIGHTMAP)
-            return importHeightmapGeometry(opts, model, geometry->HeightmapShape(), static_, respondable, mass);
+            return importHeightmapGeometry(ctx, model, geometry->HeightmapShape(), static_, respondable, mass);
         else if(geometry->Type() == sdf::GeometryType::MESH)
-            return importMeshGeometry(opts, model, geometry->MeshShape(), static_, respondable, mass);
+            return importMeshGeometry(ctx, model, geometry->MeshShape(), static_, respondable, mass);
         else
             throw sim::exception("the geometry type \"%s\" is not currently supported", geometry->Element()->GetAttribute("type")->GetAsString());
 
         return handle;
     }
 
-    int importSensor(const ImportOptions &opts, int parentHandle, C7Vector parentPose, const sdf::Camera *camera)
+    int importSensor(ImportContext &ctx, int parentHandle, C7Vector parentPose, const sdf::Camera *camera)
     {
         int options = 0
             + 1*1   // the sensor will be explicitely handled
@@ -441,7 +1265,7 @@ public:
     }
 
 #if 0
-    int importSensor(const ImportOptions &opts, int parentHandle, C7Vector parentPose, const sdf::LogicalCamera *lc)
+    int importSensor(ImportContext &ctx, int parentHandle, C7Vector parentPose, const sdf::LogicalCamera *lc)
     {
         int sensorType = sim_proximitysensor_pyramid;
         //int subType = sim_objectspecialproperty_detectable_all;
@@ -488,13 +1312,29 @@ public:
     }
 #endif
 
-#if 0
-    int importSensor(const ImportOptions &opts, int parentHandle, C7Vector parentPose, const sdf::Ray *ray)
+    C4Vector getBeamOrientation(double h, double v)
+    {
+        // sensors look along their +Z axis: map Z to the beam direction, and Y to the up vector
+        C4Vector r0(2 * piValue / 3, C3Vector(1, 1, 1) * (1 / sqrt(3.0)));
+        C4Vector yaw(h, C3Vector(0, 0, 1));
+        C4Vector pitch(-v, C3Vector(0, 1, 0));
+        return yaw * pitch * r0;
+    }
+
+    int importSensor(ImportContext &ctx, int parentHandle, C7Vector parentPose, const sdf::Lidar *lidar)
     {
-        if(!ray.scan.vertical && ray.scan.horizontal.samples == 1)
+        int hSamples = std::max(1, int(lidar->HorizontalScanSamples()));
+        int vSamples = std::max(1, int(lidar->VerticalScanSamples()));
+        double hMin = lidar->HorizontalScanMinAngle().Radian(), hMax = lidar->HorizontalScanMaxAngle().Radian();
+        double vMin = lidar->VerticalScanMinAngle().Radian(), vMax = lidar->VerticalScanMaxAngle().Radian();
+        if(hSamples == 1) hMax = hMin;
+        if(vSamples == 1) vMax = vMin;
+        double rangeMin = std::max(1e-3, lidar->RangeMin()), rangeMax = lidar->RangeMax();
+
+        if(hSamples == 1 && vSamples == 1)
         {
             // single ray -> use proximity sensor
-            int sensorType = sim_proximitysensor_pyramid;
+            int sensorType = sim_proximitysensor_ray;
             //int subType = sim_objectspecialproperty_detectable_all;
             int options = 0
                 + 1*1   // the sensor will be explicitely handled
@@ -519,12 +1359,12 @@ public:
                 0  // reserved. Set to 0
             };
             double floatParams[15] = {
-                0.1, // offset (volume description)
-                0.4, // range (volume description)
-                0.2, // x size (volume description)
-                0.2, // y size (volume description)
-                0.4, // x size far (volume description)
-                0.4, // y size far (volume description)
+                rangeMin, // offset (volume description)
+                rangeMax - rangeMin, // range (volume description)
+                0, // x size (volume description)
+                0, // y size (volume description)
+                0, // x size far (volume description)
+                0, // y size far (volume description)
                 0, // inside gap (volume description)
                 0, // radius (volume description)
                 0, // radius far (volume description)
@@ -535,14 +1375,75 @@ public:
                 0, // reserved. Set to 0.0
                 0  // reserved. Set to 0.0
             };
-            return sim::createProximitySensor(sensorType, options, intParams, floatParams);
+            int handle = sim::createProximitySensor(sensorType, options, intParams, floatParams);
+            C4Vector q = getBeamOrientation(hMin, vMin);
+            sim::setObjectOrientation(handle, -1, q.getEulerAngles().data);
+            return handle;
         }
-        else
+
+        // multiple beams -> use vision sensors (depth buffer), each covering
+        // at most maxFov horizontally and vertically (in a grid of
+        // hSensorCount x vSensorCount sensors, each pointing at the center of
+        // its cell), since a planar projection cannot cover large angles; the
+        // mismatch between the spherical scan and the planar images is
+        // resolved by a lookup table, computed here once:
+        const double maxFov = piValue / 2;
+        double hFov = hMax - hMin, vFov = vMax - vMin;
+        int hSensorCount = std::max(1, int(ceil(hFov / maxFov - 1e-9)));
+        int vSensorCount = std::max(1, int(ceil(vFov / maxFov - 1e-9)));
+        int sensorCount = hSensorCount * vSensorCount;
+        double hSensorFov = hFov / hSensorCount, vSensorFov = vFov / vSensorCount;
+        double hStep = hSamples > 1 ? hFov / (hSamples - 1) : 0;
+        double vStep = vSamples > 1 ? vFov / (vSamples - 1) : 0;
+
+        // sensor of each beam, and beam direction in the image plane of its
+        // sensor (image columns grow towards the sensor's -X axis, rows
+        // towards its +Y axis):
+        struct Projection { int sensor; double px, py; };
+        vector<Projection> projections(hSamples * vSamples);
+        double ex = 0, ey = 0;
+        for(int j = 0; j < vSamples; j++)
+        {
+            double v = vMin + j * vStep;
+            int kv = vSensorFov > 0 ? std::min(vSensorCount - 1, int((v - vMin) / vSensorFov)) : 0;
+            double vc = vMin + vSensorFov * (kv + 0.5);
+            for(int i = 0; i < hSamples; i++)
+            {
+                double h = hMin + i * hStep;
+                int kh = hSensorFov > 0 ? std::min(hSensorCount - 1, int((h - hMin) / hSensorFov)) : 0;
+                double dh = h - (hMin + hSensorFov * (kh + 0.5));
+                // beam direction in the frame of the sensor (X forward, Z up),
+                // i.e. rotated by -dh around Z, then by vc around Y:
+                double ax = cos(v) * cos(dh), ay = cos(v) * sin(dh), az = sin(v);
+                double x = ax * cos(vc) + az * sin(vc), z = -ax * sin(vc) + az * cos(vc);
+                Projection &p = projections[j * hSamples + i];
+                p.sensor = kv * hSensorCount + kh;
+                p.px = ay / x;
+                p.py = z / x;
+                ex = std::max(ex, fabs(p.px));
+                ey = std::max(ey, fabs(p.py));
+            }
+        }
+
+        // pixel pitch (in image plane units, i.e. tangent of angle): at the
+        // image center one pixel must not span more than one beam:
+        double pitch = std::numeric_limits<double>::infinity();
+        if(hStep > 0) pitch = std::min(pitch, hStep);
+        if(vStep > 0) pitch = std::min(pitch, vStep);
+        const int maxResolution = 4096;
+        ex = std::max(ex, pitch / 2);
+        ey = std::max(ey, pitch / 2);
+        pitch = std::max(pitch, 2 * std::max(ex, ey) / maxResolution);
+        int resX = std::max(1, int(ceil(2 * ex / pitch)));
+        int resY = std::max(1, int(ceil(2 * ey / pitch)));
+        double viewAngle = 2 * atan(std::max(resX, resY) * pitch / 2);
+
+        int handle = sim::createDummy(0.01);
+        for(int k = 0; k < sensorCount; k++)
         {
-            // use a vision sensor, which is faster
             int options = 0
                 + 1*1   // the sensor will be explicitely handled
-                + 0*2   // the sensor will be in perspective operation mode
+                + 1*2   // the sensor will be in perspective operation mode
                 + 0*4   // the sensor volume will not be shown when not detecting anything
                 + 0*8   // the sensor volume will not be shown when detecting something
                 + 0*16  // the sensor will be passive (use an external image)
@@ -551,46 +1452,73 @@ public:
                 + 0*128 // the sensor will use a specific color for default background (i.e. "null" pixels)
                 ;
             int intParams[4] = {
-                // FIXME: this is wrong, as it does not take into account nonlinearity of spherical coordinates:
-                ray.scan.horizontal.samples, // sensor resolution x
-                ray.scan.vertical ? ray.scan.vertical->samples : 1, // sensor resolution y
+                resX, // sensor resolution x
+                resY, // sensor resolution y
                 0, // reserved. Set to 0
                 0 // reserver. Set to 0
             };
-            double fov = ray.scan.horizontal.maxAngle - ray.scan.horizontal.minAngle;
-            if(ray.scan.vertical)
-            {
-                double vfov = ray.scan.vertical->maxAngle - ray.scan.vertical->minAngle;
-                if(vfov > fov) fov = vfov;
-            }
             double floatParams[11] = {
-                ray.range.min, // near clipping plane
-                ray.range.max, // far clipping plane
-                fov, // view angle / ortho view size
-                0.2f, // sensor size x
-                0.2f, // sensor size y
-                0.4f, // sensor size z
+                rangeMin, // near clipping plane
+                rangeMax, // far clipping plane
+                viewAngle, // view angle / ortho view size
+                0.01f, // sensor size x
+                0.01f, // sensor size y
+                0.02f, // sensor size z
                 0.0f, // "null" pixel red-value
                 0.0f, // "null" pixel green-value
                 0.0f, // "null" pixel blue-value
                 0.0f, // reserved. Set to 0.0
                 0.0f // reserved. Set to 0.0
             };
-            return sim::createVisionSensor(options, intParams, floatParams);
+            int sensorHandle = sim::createVisionSensor(options, intParams, floatParams);
+            double hCenter = hMin + hSensorFov * (k % hSensorCount + 0.5);
+            double vCenter = vMin + vSensorFov * (k / hSensorCount + 0.5);
+            sim::setObjectOrientation(sensorHandle, -1, getBeamOrientation(hCenter, vCenter).getEulerAngles().data);
+            sim::setObjectParent(sensorHandle, handle, true);
+            setSimObjectName(ctx, sensorHandle, "depth" + std::to_string(k));
+            sim::writeCustomDataBlock(sensorHandle, "sdfLidarSensor", std::to_string(k));
+        }
+
+        vector<LidarBeam> lut(hSamples * vSamples);
+        for(int i = 0; i < lut.size(); i++)
+        {
+            const Projection &p = projections[i];
+            int col = std::min(resX - 1, std::max(0, int(floor(resX / 2.0 - p.px / pitch))));
+            int row = std::min(resY - 1, std::max(0, int(floor(resY / 2.0 + p.py / pitch))));
+            LidarBeam &b = lut[i];
+            b.sensor = p.sensor;
+            b.pixel = row * resX + col;
+            // the depth buffer holds the distance along the optical axis:
+            b.scale = float(sqrt(1 + p.px * p.px + p.py * p.py));
         }
+
+        LidarHeader header;
+        header.version = 1;
+        header.horizontalSamples = hSamples;
+        header.verticalSamples = vSamples;
+        header.sensorCount = sensorCount;
+        header.rangeMin = rangeMin;
+        header.rangeMax = rangeMax;
+        string data(sizeof(header) + lut.size() * sizeof(LidarBeam), '\0');
+        std::memcpy(&data[0], &header, sizeof(header));
+        std::memcpy(&data[sizeof(header)], lut.data(), lut.size() * sizeof(LidarBeam));
+        sim::writeCustomDataBlock(handle, "sdfLidar", data);
+        DEBUG_LOG(ctx, "lidar: %dx%d beams -> %dx%d vision sensors of %dx%d pixels", hSamples, vSamples, hSensorCount, vSensorCount, resX, resY);
+        return handle;
     }
-#endif
 
-    int importSensor(const ImportOptions &opts, int parentHandle, C7Vector parentPose, const sdf::Sensor *sensor)
+    int importSensor(ImportContext &ctx, int parentHandle, C7Vector parentPose, const sdf::Sensor *sensor)
     {
         int handle = -1;
 
+        checkSensor(sensor);
+
         if(sensor->Type() == sdf::SensorType::CAMERA)
-            handle = importSensor(opts, parentHandle, parentPose, sensor->CameraSensor());
+            handle = importSensor(ctx, parentHandle, parentPose, sensor->CameraSensor());
         //else if(sensor->Type() == sdf::SensorType::LOGICAL_CAMERA)
-        //    handle = importSensor(opts, parentHandle, parentPose, sensor->LogicalCameraSensor());
-        //else if(sensor->Type() == sdf::SensorType::RAY)
-        //    handle = importSensor(opts, parentHandle, parentPose, sensor->RaySensor());
+        //    handle = importSensor(ctx, parentHandle, parentPose, sensor->LogicalCameraSensor());
+        else if(sensor->Type() == sdf::SensorType::LIDAR || sensor->Type() == sdf::SensorType::GPU_LIDAR)
+            handle = importSensor(ctx, parentHandle, parentPose, sensor->LidarSensor());
         else throw sim::exception("the sensor type \"%s\" is not currently supported", sensor->Element()->GetAttribute("type")->GetAsString());
 
         // for sensors with missing implementation, we create just a dummy
@@ -599,9 +1527,9 @@ public:
             handle = sim::createDummy(0);
         }
 
-        setSimObjectName(opts, handle, sensor->Name());
+        setSimObjectName(ctx, handle, sensor->Name());
 
-        C7Vector pose = parentPose * getPose(opts, sensor->RawPose());
+        C7Vector pose = parentPose * getPose(ctx, sensor->RawPose());
         simMultiplyObjectMatrix(handle, pose);
 
         sim::setObjectParent(handle, parentHandle, true);
@@ -609,14 +1537,436 @@ public:
         return handle;
     }
 
-    void importModelLink(const ImportOptions &opts, const sdf::Model *model, const sdf::Link *link, int parentJointHandle)
+    bool isPrimitiveGeometry(const sdf::Geometry *geometry)
+    {
+        return geometry->Type() == sdf::GeometryType::BOX
+            || geometry->Type() == sdf::GeometryType::SPHERE
+            || geometry->Type() == sdf::GeometryType::CYLINDER;
+    }
+
+    void setShapeFriction(int shapeHandle, double friction)
+    {
+        sim::setEngineFloatParam(sim_bullet_body_oldfriction, shapeHandle, NULL, friction);
+        sim::setEngineFloatParam(sim_bullet_body_friction, shapeHandle, NULL, friction);
+        sim::setEngineFloatParam(sim_ode_body_friction, shapeHandle, NULL, friction);
+        sim::setEngineFloatParam(sim_vortex_body_primlinearaxisfriction, shapeHandle, NULL, friction);
+        sim::setEngineFloatParam(sim_vortex_body_seclinearaxisfriction, shapeHandle, NULL, friction);
+        sim::setEngineFloatParam(sim_newton_body_staticfriction, shapeHandle, NULL, friction);
+        sim::setEngineFloatParam(sim_newton_body_kineticfriction, shapeHandle, NULL, friction);
+    }
+
+    int compoundCollisionShapes(ImportContext &ctx, const vector<int> &primitiveHandles, const vector<int> &meshHandles)
+    {
+        TRACE_SPAN(ctx, "sim", "groupShapes");
+        if(!ctx.opts.compoundCollisions)
+        {
+            // old behavior: group everything as it is
+            vector<int> handles(primitiveHandles);
+            handles.insert(handles.end(), meshHandles.begin(), meshHandles.end());
+            ctx.stats.collisionShapeCount += handles.size();
+            if(handles.size() == 1)
+                return handles[0];
+            return sim::groupShapes(handles);
+        }
+
+        // primitives are grouped into a pure compound, which the engines
+        // handle much faster than a mesh:
+        int primitivesHandle = -1;
+        if(primitiveHandles.size() == 1)
+        {
+            primitivesHandle = primitiveHandles[0];
+            ctx.stats.collisionShapeCount++;
+        }
+        else if(primitiveHandles.size() > 1)
+        {
+            primitivesHandle = sim::groupShapes(primitiveHandles);
+            ctx.stats.collisionShapeCount += primitiveHandles.size();
+            ctx.stats.pureCompoundCount++;
+        }
+
+        // small non-convex meshes of the link are merged into a single mesh;
+        // convex meshes (e.g. pieces of a convex decomposition) and large
+        // meshes are kept as separate elements of the compound, as merging
+        // them would only make a bigger non-convex mesh:
+        const int mergeMeshMaxTriangles = 1000;
+        vector<int> smallMeshHandles, handles;
+        for(int h : meshHandles)
+        {
+            if(!sim::getObjectInt32Param(h, sim_shapeintparam_convex) && getShapeTriangleCount(h) <= mergeMeshMaxTriangles)
+                smallMeshHandles.push_back(h);
+            else
+                handles.push_back(h);
+        }
+        ctx.stats.collisionShapeCount += handles.size();
+        if(smallMeshHandles.size() == 1)
+        {
+            handles.push_back(smallMeshHandles[0]);
+            ctx.stats.collisionShapeCount++;
+        }
+        else if(smallMeshHandles.size() > 1)
+        {
+            handles.push_back(sim::groupShapes(smallMeshHandles, true));
+            ctx.stats.collisionShapeCount++;
+            ctx.stats.mergedMeshCount++;
+        }
+
+        if(primitivesHandle != -1)
+            handles.insert(handles.begin(), primitivesHandle);
+        if(handles.size() == 1)
+            return handles[0];
+        return sim::groupShapes(handles);
+    }
+
+    int getShapeTriangleCount(int shapeHandle)
+    {
+        double *vertices;
+        int verticesSize;
+        int *indices;
+        int indicesSize;
+        sim::getShapeMesh(shapeHandle, &vertices, &verticesSize, &indices, &indicesSize);
+        sim::releaseBuffer(vertices);
+        sim::releaseBuffer(indices);
+        return indicesSize / 3;
+    }
+
+    void setShapeColor(int shapeHandle, int colorComponent, const gz::math::Color &color)
+    {
+        float rgb[3] = {color.R(), color.G(), color.B()};
+        if(simSetShapeColor(shapeHandle, nullptr, colorComponent, rgb) == -1)
+            throw sim::exception("failed to set color of shape %d", shapeHandle);
+    }
+
+    int getTexture(ImportContext &ctx, const string &filename)
+    {
+        // textures are loaded once per import, and shared by all shapes using them
+        auto it = ctx.textureCache.find(filename);
+        if(it != ctx.textureCache.end())
+            return it->second.textureId;
+
+        TRACE_SPAN(ctx, "sim", "createTexture " + filename);
+        TextureCacheEntry entry;
+        int resolution[2];
+        string localPath = getLocalPath(ctx, filename);
+        // when the size is known from the image header, the texture is
+        // loaded once at the final (possibly reduced) resolution:
+        int fixedResolution = 0;
+        if(ctx.opts.maxTextureSize > 0 && getImageSize(readResource(ctx, filename), resolution[0], resolution[1]))
+        {
+            int maxSize = std::max(resolution[0], resolution[1]);
+            if(maxSize > ctx.opts.maxTextureSize)
+            {
+                DEBUG_LOG(ctx, "downscaling texture %s (%dx%d)", filename, resolution[0], resolution[1]);
+                for(int i = 0; i < 2; i++)
+                    resolution[i] = std::max(1, resolution[i] * ctx.opts.maxTextureSize / maxSize);
+                fixedResolution = 1;
+            }
+        }
+        entry.planeHandle = simCreateTexture(localPath.c_str(), 0, nullptr, nullptr, nullptr, fixedResolution, &entry.textureId, resolution, nullptr);
+        if(entry.planeHandle == -1)
+            throw sim::exception("failed to load texture '%s'", filename);
+        int maxSize = std::max(resolution[0], resolution[1]);
+        if(ctx.opts.maxTextureSize > 0 && maxSize > ctx.opts.maxTextureSize)
+        {
+            // other formats: reload at the reduced resolution
+            DEBUG_LOG(ctx, "downscaling texture %s (%dx%d)", filename, resolution[0], resolution[1]);
+            sim::removeObjects({entry.planeHandle});
+            for(int i = 0; i < 2; i++)
+                resolution[i] = std::max(1, resolution[i] * ctx.opts.maxTextureSize / maxSize);
+            entry.planeHandle = simCreateTexture(localPath.c_str(), 0, nullptr, nullptr, nullptr, 1, &entry.textureId, resolution, nullptr);
+            if(entry.planeHandle == -1)
+                throw sim::exception("failed to load texture '%s'", filename);
+        }
+        ctx.textureCache[filename] = entry;
+        ctx.stats.textureCount++;
+        return entry.textureId;
+    }
+
+    void clearTextureCache(ImportContext &ctx)
+    {
+        // the textures stay alive as long as some shape uses them, so the
+        // planes created by simCreateTexture can go:
+        vector<int> handles;
+        for(const auto &x : ctx.textureCache)
+            handles.push_back(x.second.planeHandle);
+        if(!handles.empty())
+            sim::removeObjects(handles);
+        ctx.textureCache.clear();
+    }
+
+    bool hasTextureCoordinates(ImportContext &ctx, const sdf::Model *model, const sdf::Geometry *geometry)
+    {
+        // the texture coordinates of a mesh are not returned by the mesh
+        // import API, so look for them in the mesh file:
+        if(!geometry || geometry->Type() != sdf::GeometryType::MESH)
+            return false;
+        string filename = getResourceFullPath(ctx, geometry->MeshShape()->Uri(), *ctx.opts.fileName, model);
+        auto it = ctx.textureCoordinates.find(filename);
+        if(it != ctx.textureCoordinates.end())
+            return it->second;
+        string lower = boost::algorithm::to_lower_copy(filename);
+        bool result = false;
+        if(boost::ends_with(lower, ".obj"))
+            result = readResource(ctx, filename).find("\nvt ") != string::npos;
+        else if(boost::ends_with(lower, ".dae"))
+            result = readResource(ctx, filename).find("TEXCOORD") != string::npos;
+        DEBUG_LOG(ctx, "mesh %s %s texture coordinates", filename, result ? "has" : "has no");
+        return ctx.textureCoordinates[filename] = result;
+    }
+
+    void applyMaterial(ImportContext &ctx, const sdf::Model *model, int shapeHandle, const sdf::Material *material, const sdf::Geometry *geometry = nullptr)
+    {
+        if(!material)
+            return;
+        // e.g. the dummy of an <empty/> geometry:
+        if(sim::getObjectType(shapeHandle) != sim_sceneobject_shape)
+            return;
+
+        // only override the colors of the mesh file if specified in the SDF:
+        sdf::ElementPtr e = material->Element();
+        if(e && e->HasElement("diffuse"))
+            setShapeColor(shapeHandle, sim_colorcomponent_ambient_diffuse, material->Diffuse());
+        if(e && e->HasElement("specular"))
+            setShapeColor(shapeHandle, sim_colorcomponent_specular, material->Specular());
+        if(e && e->HasElement("emissive"))
+            setShapeColor(shapeHandle, sim_colorcomponent_emission, material->Emissive());
+
+        if(material->PbrMaterial())
+        {
+            const sdf::PbrWorkflow *w = material->PbrMaterial()->Workflow(sdf::PbrWorkflowType::METAL);
+            if(!w) w = material->PbrMaterial()->Workflow(sdf::PbrWorkflowType::SPECULAR);
+            if(w && w->AlbedoMap() != "")
+            {
+                if(!ctx.opts.fileName)
+                    throw sim::exception("field 'fileName' must be set to the path of the SDF file");
+                string sdfFile = material->FilePath() != "" ? material->FilePath() : *ctx.opts.fileName;
+                string filename = getResourceFullPath(ctx, w->AlbedoMap(), sdfFile, model);
+                // simSetShapeTexture can only generate the texture
+                // coordinates, so meshes with their own keep them (and the
+                // texture of the mesh file, if any):
+                if(hasTextureCoordinates(ctx, model, geometry))
+                {
+                    DEBUG_LOG(ctx, "not applying texture %s to shape %d: mesh has texture coordinates", filename, shapeHandle);
+                    return;
+                }
+                int textureId = getTexture(ctx, filename);
+                double uvScaling[2] = {1.0, 1.0};
+                int options = 1 + 4 + 8; // interpolate colors, repeat along u and v
+                if(simSetShapeTexture(shapeHandle, textureId, sim_texturemap_cube, options, uvScaling, nullptr, nullptr) == -1)
+                    throw sim::exception("failed to apply texture '%s' to shape %d", filename, shapeHandle);
+                ctx.stats.texturedShapeCount++;
+            }
+        }
+    }
+
+    // whether applyMaterial maps the albedo map of the SDF material onto the shape:
+    bool hasSDFTexture(ImportContext &ctx, const sdf::Model *model, const sdf::Material *material, const sdf::Geometry *geometry)
+    {
+        if(!material || !material->PbrMaterial())
+            return false;
+        const sdf::PbrWorkflow *w = material->PbrMaterial()->Workflow(sdf::PbrWorkflowType::METAL);
+        if(!w) w = material->PbrMaterial()->Workflow(sdf::PbrWorkflowType::SPECULAR);
+        return w && w->AlbedoMap() != "" && !hasTextureCoordinates(ctx, model, geometry);
+    }
+
+    void importVisualLods(ImportContext &ctx, const sdf::Model *model, int shapeHandle, int parentHandle, const string &name, const sdf::Material *material, const sdf::Geometry *geometry = nullptr)
+    {
+        TRACE_SPAN(ctx, "sim", "decimate " + name);
+        // the LOD shapes are created from vertices and indices, so only
+        // get the colors copied from the full resolution shape, and the SDF
+        // material: skip shapes with a texture of the mesh file, or made of
+        // several elements (which can have their own colors):
+        if((simGetShapeTextureId(shapeHandle) != -1 && !hasSDFTexture(ctx, model, material, geometry))
+                || sim::getObjectInt32Param(shapeHandle, sim_shapeintparam_compound))
+        {
+            DEBUG_LOG(ctx, "%s: not generating LODs, as the appearance of the shape can't be reproduced", name);
+            return;
+        }
+        const int colorComponents[] = {sim_colorcomponent_ambient_diffuse, sim_colorcomponent_specular, sim_colorcomponent_emission, sim_colorcomponent_transparency};
+        float colors[4][3];
+        for(int c = 0; c < 4; c++)
+            simGetShapeColor(shapeHandle, nullptr, colorComponents[c], colors[c]);
+        double* vertices;
+        int verticesSize;
+        int* indices;
+        int indicesSize;
+        sim::getShapeMesh(shapeHandle, &vertices, &verticesSize, &indices, &indicesSize);
+        // not worth simplifying:
+        const int minTriangles = 500;
+        if(indicesSize / 3 < minTriangles)
+        {
+            sim::releaseBuffer(vertices);
+            sim::releaseBuffer(indices);
+            return;
+        }
+        // vertices are relative to the shape frame; use absolute coordinates,
+        // so that the new shapes are created in place:
+        C7Vector tr;
+        sim::getObjectPosition(shapeHandle, -1, tr.X.data);
+        C3Vector euler;
+        sim::getObjectOrientation(shapeHandle, -1, euler.data);
+        tr.Q.setEulerAngles(euler);
+        for(int i = 0; i < verticesSize / 3; i++)
+        {
+            C3Vector v(vertices + 3 * i);
+            v *= tr;
+            vertices[3 * i + 0] = v(0);
+            vertices[3 * i + 1] = v(1);
+            vertices[3 * i + 2] = v(2);
+        }
+
+        // level k is decimated from level k - 1, keeping about 1/4 of its
+        // triangles (the percentage passed to simGetDecimatedMesh is the
+        // fraction of triangles to remove), and is shown beyond
+        // visualLodDistance * 2^(k-1):
+        int levels = std::min(ctx.opts.visualLodLevels, 3);
+        std::stringstream distances;
+        int triangleCount = indicesSize / 3;
+        for(int k = 1; k <= levels; k++)
+        {
+            double* lodVertices;
+            int lodVerticesSize;
+            int* lodIndices;
+            int lodIndicesSize;
+            if(simGetDecimatedMesh(vertices, verticesSize, indices, indicesSize, &lodVertices, &lodVerticesSize, &lodIndices, &lodIndicesSize, 0.75, 0, nullptr) == -1)
+            {
+                sim::addLog(sim_verbosity_warnings, "failed to simplify mesh of %s (LOD %d)", name, k);
+                break;
+            }
+            if(lodIndicesSize >= indicesSize)
+            {
+                sim::addLog(sim_verbosity_warnings, "simplifying mesh of %s (LOD %d) did not reduce its triangle count", name, k);
+                sim::releaseBuffer(lodVertices);
+                sim::releaseBuffer(lodIndices);
+                break;
+            }
+            int lodHandle = sim::createMeshShape(0, 20.0f * piValue / 180.0f, lodVertices, lodVerticesSize, lodIndices, lodIndicesSize);
+            DEBUG_LOG(ctx, "%s: LOD %d has %d triangles (of %d)", name, k, lodIndicesSize / 3, triangleCount);
+            sim::setObjectParent(lodHandle, parentHandle, true);
+            setSimObjectName(ctx, lodHandle, name + "_lod" + std::to_string(k));
+            for(int c = 0; c < 4; c++)
+                simSetShapeColor(lodHandle, nullptr, colorComponents[c], colors[c]);
+            applyMaterial(ctx, model, lodHandle, material, geometry);
+            sim::setObjectInt32Param(lodHandle, sim_shapeintparam_edge_visibility, 0);
+            sim::setObjectInt32Param(lodHandle, sim_objintparam_visibility_layer, 0);
+            sim::writeCustomDataBlock(lodHandle, "sdfLodLevel", name + "\n" + std::to_string(k));
+            lodHandles.insert(lodHandle);
+            distances << (k > 1 ? " " : "") << ctx.opts.visualLodDistance * (1 << (k - 1));
+            ctx.stats.lodShapeCount++;
+            // the next level is decimated from this one:
+            sim::releaseBuffer(vertices);
+            sim::releaseBuffer(indices);
+            vertices = lodVertices;
+            verticesSize = lodVerticesSize;
+            indices = lodIndices;
+            indicesSize = lodIndicesSize;
+        }
+        sim::releaseBuffer(vertices);
+        sim::releaseBuffer(indices);
+        if(!distances.str().empty())
+        {
+            sim::writeCustomDataBlock(shapeHandle, "sdfLod", name + "\n" + distances.str());
+            lodHandles.insert(shapeHandle);
+        }
+        lodGroupsDirty = true;
+    }
+
+    void importMergedVisuals(ImportContext &ctx, const sdf::Model *model, const sdf::Link *link, const C7Vector &linkPose, int parentHandle)
+    {
+        // visuals sharing the same material are concatenated (in the link
+        // frame) into one mesh, before creating any shape; visuals whose
+        // appearance comes from their mesh file are imported individually:
+        vector<string> keys;
+        ImportArena::Scope scope(ctx.arena);
+        map<string, MeshData> meshes;
+        map<string, vector<string>> names;
+        map<string, const sdf::Material*> materials;
+        for(int i = 0; i < link->VisualCount(); i++)
+        {
+            const sdf::Visual *visual = link->VisualByIndex(i);
+            MeshData mesh(ctx.arena);
+            if(!hasSDFAppearance(ctx, model, visual->Geom()) || !getGeometryMesh(ctx, model, visual->Geom(), mesh))
+            {
+                // not representable as a mesh (e.g. heightmap), or with its
+                // own colors/textures: import as usual
+                int shapeHandle = importGeometry(ctx, model, visual->Geom(), true, false, 0);
+                if(shapeHandle == -1) continue;
+                ctx.stats.visualCount++;
+                ctx.stats.visualShapeCount++;
+                simMultiplyObjectMatrix(shapeHandle, linkPose * getPose(ctx, visual->RawPose()));
+                sim::setObjectParent(shapeHandle, parentHandle, true);
+                string name = link->Name() + "_" + visual->Name();
+                setSimObjectName(ctx, shapeHandle, name);
+                applyMaterial(ctx, model, shapeHandle, visual->Material(), visual->Geom());
+                if(ctx.opts.visualLodLevels > 0 && visual->Geom()->Type() == sdf::GeometryType::MESH)
+                    importVisualLods(ctx, model, shapeHandle, parentHandle, name, visual->Material(), visual->Geom());
+                continue;
+            }
+            ctx.stats.visualCount++;
+            string key = getMaterialKey(visual->Material());
+            if(meshes.find(key) == meshes.end())
+            {
+                keys.push_back(key);
+                meshes.emplace(key, MeshData(ctx.arena));
+            }
+            meshes.at(key).append(mesh, getPose(ctx, visual->RawPose()));
+            names[key].push_back(visual->Name());
+            materials[key] = visual->Material();
+        }
+
+        for(int k = 0; k < keys.size(); k++)
+        {
+            const MeshData &mesh = meshes.at(keys[k]);
+            if(mesh.indices.empty()) continue;
+            int shapeHandle = sim::createMeshShape(0, 20.0f * piValue / 180.0f, mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+            ctx.stats.visualShapeCount++;
+            simMultiplyObjectMatrix(shapeHandle, linkPose);
+            sim::setObjectParent(shapeHandle, parentHandle, true);
+            string name = link->Name() + "_visual";
+            if(keys.size() > 1)
+                name += "_" + std::to_string(k);
+            setSimObjectName(ctx, shapeHandle, name);
+            applyMaterial(ctx, model, shapeHandle, materials[keys[k]]);
+            sim::writeCustomDataBlock(shapeHandle, "sdfVisualNames", boost::algorithm::join(names[keys[k]], "\n"));
+            DEBUG_LOG(ctx, "merged visuals of link %s into %s: %s", link->Name(), name, boost::algorithm::join(names[keys[k]], ", "));
+            if(ctx.opts.visualLodLevels > 0)
+                importVisualLods(ctx, model, shapeHandle, parentHandle, name, materials[keys[k]]);
+        }
+    }
+
+    bool isSelected(const vector<string> &include, const vector<string> &exclude, const string &name)
+    {
+        auto matches = [&] (const vector<string> &patterns)
+        {
+            for(const string &pattern : patterns)
+                if(matchGlob(pattern, name))
+                    return true;
+            return false;
+        };
+        return (include.empty() || matches(include)) && !matches(exclude);
+    }
+
+    bool isModelSelected(ImportContext &ctx, const string &name)
+    {
+        return isSelected(ctx.opts.includeModels, ctx.opts.excludeModels, name);
+    }
+
+    bool isLinkSelected(ImportContext &ctx, const sdf::Link *link)
+    {
+        return isSelected(ctx.opts.includeLinks, ctx.opts.excludeLinks, link->Name());
+    }
+
+    void importModelLink(ImportContext &ctx, ModelTables &tables, int linkIndex, int parentJointHandle)
     {
-        sim::addLog(sim_verbosity_debug, "Importing link '" + link->Name() + "' of model '" + model->Name() + "'...");
+        const sdf::Model *model = tables.model;
+        const sdf::Link *link = model->LinkByIndex(linkIndex);
+        TRACE_SPAN(ctx, "link", link->Name());
+        DEBUG_LOG(ctx, "Importing link '%s' of model '%s'...", link->Name(), model->Name());
+        ctx.stats.linkCount++;
 
-        C7Vector modelPose = getPose(opts, model->RawPose());
-        C7Vector linkPose = modelPose * getPose(opts, link->RawPose());
-        sim::addLog(sim_verbosity_debug, "modelPose: %s", modelPose);
-        sim::addLog(sim_verbosity_debug, "linkPose: %s", linkPose);
+        C7Vector modelPose = getPose(ctx, model->RawPose());
+        C7Vector linkPose = modelPose * getPose(ctx, link->RawPose());
+        DEBUG_LOG(ctx, "modelPose: %s", modelPose);
+        DEBUG_LOG(ctx, "linkPose: %s", linkPose);
 
         double mass = 0;
         //if(link.inertial && link.inertial->mass)
@@ -624,15 +1974,19 @@ public:
         //    mass = *link.inertial->mass;
         //}
 
-        vector<int> shapeHandlesColl;
-        for(int i = 0; i < link->CollisionCount(); i++)
+        vector<int> primitiveHandlesColl, meshHandlesColl;
+        vector<double> frictions;
+        for(int i = 0; ctx.opts.importCollisions && i < link->CollisionCount(); i++)
         {
             const sdf::Collision *collision = link->CollisionByIndex(i);
-            int shapeHandle = importGeometry(opts, model, collision->Geom(), false, true, mass);
+            int shapeHandle = importGeometry(ctx, model, collision->Geom(), false, true, mass);
             if(shapeHandle == -1) continue;
-            shapeHandlesColl.push_back(shapeHandle);
-            C7Vector collPose = linkPose * getPose(opts, collision->RawPose());
-            sim::addLog(sim_verbosity_debug, "collision %s pose %s", collision->Name(), collPose);
+            if(isPrimitiveGeometry(collision->Geom()))
+                primitiveHandlesColl.push_back(shapeHandle);
+            else
+                meshHandlesColl.push_back(shapeHandle);
+            C7Vector collPose = linkPose * getPose(ctx, collision->RawPose());
+            DEBUG_LOG(ctx, "collision %s pose %s", collision->Name(), collPose);
             simMultiplyObjectMatrix(shapeHandle, collPose);
             if(collision->Surface())
             {
@@ -641,47 +1995,42 @@ public:
                 if(surface->Friction())
                 {
                     const sdf::Friction *f = surface->Friction();
-                    double friction = 0.0;
-                    bool set = false;
                     if(f->ODE())
-                    {
-                        friction = 0.5 * (f->ODE()->Mu() + f->ODE()->Mu2());
-                        set = true;
-                    }
-                    if(set)
-                    {
-                        sim::setEngineFloatParam(sim_bullet_body_oldfriction, shapeHandle, NULL, friction);
-                        sim::setEngineFloatParam(sim_bullet_body_friction, shapeHandle, NULL, friction);
-                        sim::setEngineFloatParam(sim_ode_body_friction, shapeHandle, NULL, friction);
-                        sim::setEngineFloatParam(sim_vortex_body_primlinearaxisfriction, shapeHandle, NULL, friction);
-                        sim::setEngineFloatParam(sim_vortex_body_seclinearaxisfriction, shapeHandle, NULL, friction);
-                        sim::setEngineFloatParam(sim_newton_body_staticfriction, shapeHandle, NULL, friction);
-                        sim::setEngineFloatParam(sim_newton_body_kineticfriction, shapeHandle, NULL, friction);
-                    }
+                        frictions.push_back(0.5 * (f->ODE()->Mu() + f->ODE()->Mu2()));
                 }
             }
         }
+        ctx.stats.collisionCount += primitiveHandlesColl.size() + meshHandlesColl.size();
         int shapeHandleColl = -1;
-        if(shapeHandlesColl.size() == 0)
+        if(primitiveHandlesColl.empty() && meshHandlesColl.empty())
         {
             sdf::Box box;
             box.SetSize(gz::math::Vector3d(0.01, 0.01, 0.01));
             sdf::Geometry g;
             g.SetBoxShape(box);
-            shapeHandleColl = importGeometry(opts, model, &g, false, false, mass);
-        }
-        else if(shapeHandlesColl.size() == 1)
-        {
-            shapeHandleColl = shapeHandlesColl[0];
+            shapeHandleColl = importGeometry(ctx, model, &g, false, false, mass);
         }
-        else if(shapeHandlesColl.size() > 1)
+        else
         {
-            shapeHandleColl = sim::groupShapes(shapeHandlesColl);
+            shapeHandleColl = compoundCollisionShapes(ctx, primitiveHandlesColl, meshHandlesColl);
+
+            // grouping/merging does not keep the flags of the individual shapes:
+            sim::setObjectInt32Param(shapeHandleColl, sim_shapeintparam_respondable, 1);
+            if(!frictions.empty())
+            {
+                // engines only have one friction value per body, so when
+                // the collisions of a link disagree we use the average:
+                double friction = 0.0;
+                for(double f : frictions)
+                    friction += f / frictions.size();
+                auto mm = std::minmax_element(frictions.begin(), frictions.end());
+                if(*mm.second - *mm.first > 1e-9)
+                    DEBUG_LOG(ctx, "link %s: collisions have different friction values; using average %f", link->Name(), friction);
+                setShapeFriction(shapeHandleColl, friction);
+            }
         }
-        linkHandle[link] = shapeHandleColl;
-        if(!modelHandle[model])
-            modelHandle[model] = linkHandle[link];
-        setSimObjectName(opts, shapeHandleColl, (boost::format("%s_collision") % link->Name()).str());
+        tables.linkHandles[linkIndex] = shapeHandleColl;
+        setSimObjectName(ctx, shapeHandleColl, link->Name() + "_collision");
 
         //if(link.inertial && link.inertial->inertia)
         //{
@@ -696,7 +2045,7 @@ public:
         //    sim::getObjectMatrix(shapeHandleColl, -1, _mtr);
         //    C4X4Matrix mtr;
         //    mtr.setData(_mtr);
-        //    C4X4Matrix t(mtr.getInverse() * (linkPose * getPose(opts, link.inertial->pose)).getMatrix());
+        //    C4X4Matrix t(mtr.getInverse() * (linkPose * getPose(ctx, link.inertial->pose)).getMatrix());
         //    double m[12] = {
         //        t.M(0,0), t.M(0,1), t.M(0,2), t.X(0),
         //        t.M(1,0), t.M(1,1), t.M(1,2), t.X(1),
@@ -715,40 +2064,53 @@ public:
             //sim::setObjectParent(shapeHandleColl, parentJointHandle, true);
         }
 
-        if(opts.hideCollisionLinks)
+        if(ctx.opts.hideCollisionLinks)
         {
             sim::setObjectInt32Param(shapeHandleColl, sim_objintparam_visibility_layer, 256); // assign collision to layer 9
         }
 
-        for(int i = 0; i < link->VisualCount(); i++)
+        if(ctx.opts.importVisuals && ctx.opts.mergeVisuals)
         {
-            const sdf::Visual *visual = link->VisualByIndex(i);
-            int shapeHandle = importGeometry(opts, model, visual->Geom(), true, false, 0);
-            if(shapeHandle == -1) continue;
-            C7Vector visPose = linkPose * getPose(opts, visual->RawPose());
-            sim::addLog(sim_verbosity_debug, "visual %s pose: %s", visual->Name(), visPose);
-            simMultiplyObjectMatrix(shapeHandle, visPose);
-            sim::setObjectParent(shapeHandle, shapeHandleColl, true);
-            setSimObjectName(opts, shapeHandle, (boost::format("%s_%s") % link->Name() % visual->Name()).str());
+            importMergedVisuals(ctx, model, link, linkPose, shapeHandleColl);
+        }
+        else if(ctx.opts.importVisuals)
+        {
+            for(int i = 0; i < link->VisualCount(); i++)
+            {
+                const sdf::Visual *visual = link->VisualByIndex(i);
+                int shapeHandle = importGeometry(ctx, model, visual->Geom(), true, false, 0);
+                if(shapeHandle == -1) continue;
+                ctx.stats.visualCount++;
+                ctx.stats.visualShapeCount++;
+                C7Vector visPose = linkPose * getPose(ctx, visual->RawPose());
+                DEBUG_LOG(ctx, "visual %s pose: %s", visual->Name(), visPose);
+                simMultiplyObjectMatrix(shapeHandle, visPose);
+                sim::setObjectParent(shapeHandle, shapeHandleColl, true);
+                string name = link->Name() + "_" + visual->Name();
+                setSimObjectName(ctx, shapeHandle, name);
+                applyMaterial(ctx, model, shapeHandle, visual->Material(), visual->Geom());
+                if(ctx.opts.visualLodLevels > 0 && visual->Geom()->Type() == sdf::GeometryType::MESH)
+                    importVisualLods(ctx, model, shapeHandle, shapeHandleColl, name, visual->Material(), visual->Geom());
+            }
         }
 
-        for(int i = 0; i < link->SensorCount(); i++)
+        for(int i = 0; ctx.opts.importSensors && i < link->SensorCount(); i++)
         {
             const sdf::Sensor *sensor = link->SensorByIndex(i);
-            int sensorHandle = importSensor(opts, shapeHandleColl, linkPose, sensor);
+            int sensorHandle = importSensor(ctx, shapeHandleColl, linkPose, sensor);
         }
     }
 
-    int importModelJoint(const ImportOptions &opts, const sdf::Model *model, const sdf::Joint *joint, int parentLinkHandle)
+    int importModelJoint(ImportContext &ctx, ModelTables &tables, int jointIndex, int parentLinkHandle)
     {
-        sim::addLog(sim_verbosity_debug, "Importing joint '%s' of model '%s'...", joint->Name(), model->Name());
+        const sdf::Model *model = tables.model;
+        const sdf::Joint *joint = model->JointByIndex(jointIndex);
+        TRACE_SPAN(ctx, "joint", joint->Name());
+        DEBUG_LOG(ctx, "Importing joint '%s' of model '%s'...", joint->Name(), model->Name());
 
         int handle = -1;
 
-        if(!joint->Axis())
-        {
-            throw sim::exception("joint must have an axis");
-        }
+        checkJoint(joint);
 
         const sdf::JointAxis *axis = joint->Axis();
 
@@ -772,12 +2134,12 @@ public:
                 sim::setObjectFloatParam(handle, sim_jointfloatparam_upper_limit, axis->MaxVelocity());
             }
 
-            if(opts.positionCtrl)
+            if(ctx.opts.positionCtrl)
             {
                 sim::setObjectInt32Param(handle, sim_jointintparam_motor_enabled, 1);
             }
 
-            if(opts.hideJoints)
+            if(ctx.opts.hideJoints)
             {
                 sim::setObjectInt32Param(handle, sim_objintparam_visibility_layer, 512); // layer 10
             }
@@ -800,24 +2162,26 @@ public:
         if(handle == -1)
             return handle;
 
-        jointHandle[joint] = handle;
+        tables.jointHandles[jointIndex] = handle;
 
         if(parentLinkHandle != -1)
         {
             //sim::setObjectParent(handle, parentLinkHandle, true);
         }
 
-        setSimObjectName(opts, handle, joint->Name());
+        setSimObjectName(ctx, handle, joint->Name());
 
         return handle;
     }
 
-    void adjustJointPose(const ImportOptions &opts, const sdf::Model *model, const sdf::Joint *joint, int childLinkHandle)
+    void adjustJointPose(ImportContext &ctx, ModelTables &tables, int jointIndex, int childLinkHandle)
     {
+        const sdf::Model *model = tables.model;
+        const sdf::Joint *joint = model->JointByIndex(jointIndex);
         const sdf::JointAxis *axis = joint->Axis();
 
-        C7Vector modelPose = getPose(opts, model->RawPose());
-        C7Vector jointPose = modelPose * getPose(opts, joint->RawPose());
+        C7Vector modelPose = getPose(ctx, model->RawPose());
+        C7Vector jointPose = modelPose * getPose(ctx, joint->RawPose());
 
         // compute joint axis orientation:
         C4X4Matrix jointAxisMatrix;
@@ -858,156 +2222,545 @@ public:
         //
         // in any case, the joint frame corresponds with the child's frame.
 
-        const sdf::Link *childLink = getChildLink(joint, model);
-        C7Vector childLinkPose = modelPose * getPose(opts, childLink->RawPose());
+        const sdf::Link *childLink = model->LinkByIndex(tables.jointChildLink[jointIndex]);
+        C7Vector childLinkPose = modelPose * getPose(ctx, childLink->RawPose());
 
-        C4X4Matrix m1 = childLinkPose * getPose(opts, joint->RawPose()).getMatrix() * jointAxisMatrix,
+        C4X4Matrix m1 = childLinkPose * getPose(ctx, joint->RawPose()).getMatrix() * jointAxisMatrix,
                    m2 = modelPose * jointAxisMatrix;
 
-        C4X4Matrix m = m1;
-        if(axis->XyzExpressedIn() == "")
-        {
-            m = m2;
-            m.X = m1.X;
-        }
-        else throw "axis frame not implemented";
+        // (axes expressed in another frame are rejected by checkJoint)
+        C4X4Matrix m = m2;
+        m.X = m1.X;
 
         C7Vector t = m.getTransformation();
-        sim::setObjectPosition(jointHandle[joint], -1, t.X.data);
-        sim::setObjectOrientation(jointHandle[joint], -1, t.Q.getEulerAngles().data);
+        sim::setObjectPosition(tables.jointHandles[jointIndex], -1, t.X.data);
+        sim::setObjectOrientation(tables.jointHandles[jointIndex], -1, t.Q.getEulerAngles().data);
+    }
+
+    void visitLink(ImportContext &ctx, ModelTables &tables, int linkIndex)
+    {
+        for(int c = tables.childJointsOffset[linkIndex]; c < tables.childJointsOffset[linkIndex + 1]; c++)
+        {
+            int jointIndex = tables.childJoints[c];
+            int childLinkIndex = tables.jointChildLink[jointIndex];
+            if(childLinkIndex == -1)
+                throw sim::exception("joint '%s' has an invalid child link '%s'", tables.model->JointByIndex(jointIndex)->Name(), tables.model->JointByIndex(jointIndex)->ChildName());
+            // an unselected link is skipped with its joint and its subtree:
+            if(!isLinkSelected(ctx, tables.model->LinkByIndex(childLinkIndex)))
+                continue;
+            importModelJoint(ctx, tables, jointIndex, tables.linkHandles[linkIndex]);
+            importModelLink(ctx, tables, childLinkIndex, tables.jointHandles[jointIndex]);
+            adjustJointPose(ctx, tables, jointIndex, tables.linkHandles[childLinkIndex]);
+            sim::setObjectParent(tables.jointHandles[jointIndex], tables.linkHandles[linkIndex], true);
+            sim::setObjectParent(tables.linkHandles[childLinkIndex], tables.jointHandles[jointIndex], true);
+            visitLink(ctx, tables, childLinkIndex);
+        }
     }
 
-    void visitLink(const ImportOptions &opts, const sdf::Model *model, const sdf::Link *link)
+    void assignRespondableMasks(ImportContext &ctx, const ModelTables &tables)
     {
-        for(const sdf::Joint *joint : getChildJoints(link, model))
+        TRACE_SPAN(ctx, "sim", "assignRespondableMasks");
+        const sdf::Model *model = tables.model;
+
+        // links without collisions have a non-respondable placeholder:
+        vector<int> links;
+        vector<int> linkPos(model->LinkCount(), -1);
+        for(int i = 0; i < model->LinkCount(); i++)
         {
-            const sdf::Link *childLink = getChildLink(joint, model);
-            importModelJoint(opts, model, joint, linkHandle[link]);
-            importModelLink(opts, model, childLink, jointHandle[joint]);
-            adjustJointPose(opts, model, joint, linkHandle[childLink]);
-            sim::setObjectParent(jointHandle[joint], linkHandle[link], true);
-            sim::setObjectParent(linkHandle[childLink], jointHandle[joint], true);
-            visitLink(opts, model, childLink);
+            int h = tables.linkHandles[i];
+            if(h == -1 || !sim::getObjectInt32Param(h, sim_shapeintparam_respondable)) continue;
+            linkPos[i] = links.size();
+            links.push_back(i);
         }
+        if(links.empty()) return;
+
+        // pairs to ignore: all of them without self-collision, otherwise
+        // the links connected by a joint, and the links already colliding
+        // in the initial (zero joint positions) configuration:
+        int n = links.size();
+        bool selfCollide = model->SelfCollide() && !ctx.opts.noSelfCollision;
+        vector<vector<bool>> ignore(n, vector<bool>(n, !selfCollide));
+        if(selfCollide)
+        {
+            for(int j = 0; j < model->JointCount(); j++)
+            {
+                int p = tables.jointParentLink[j], c = tables.jointChildLink[j];
+                if(p == -1 || c == -1 || linkPos[p] == -1 || linkPos[c] == -1) continue;
+                ignore[linkPos[p]][linkPos[c]] = ignore[linkPos[c]][linkPos[p]] = true;
+            }
+            for(int a = 0; a < n; a++)
+            {
+                for(int b = a + 1; b < n; b++)
+                {
+                    if(ignore[a][b]) continue;
+                    if(simCheckCollision(tables.linkHandles[links[a]], tables.linkHandles[links[b]]) == 1)
+                    {
+                        DEBUG_LOG(ctx, "links %s and %s overlap in the initial configuration; ignoring their collisions", model->LinkByIndex(links[a])->Name(), model->LinkByIndex(links[b])->Name());
+                        ignore[a][b] = ignore[b][a] = true;
+                    }
+                }
+            }
+        }
+
+        // the upper 8 bits (collisions with other models) are always set:
+        RespondableMasksPlan plan = planRespondableMasks(ignore);
+        for(int k = 0; k < n; k++)
+            sim::setObjectInt32Param(tables.linkHandles[links[k]], sim_shapeintparam_respondable_mask, 0xff00 | plan.masks[k]);
+        ctx.stats.activeCollisionPairs += plan.activePairs;
+        DEBUG_LOG(ctx, "model %s: %d of %d link pairs can collide", model->Name(), plan.activePairs, n * (n - 1) / 2);
+        if(plan.droppedPairs > 0)
+            sim::addLog(sim_verbosity_warnings, "model %s: not enough collision mask bits; %d link pairs are not tested for collision", model->Name(), plan.droppedPairs);
     }
 
-    void importModel(const ImportOptions &opts, const sdf::Model *model, bool topLevel = true)
+    void importModel(ImportContext &ctx, const sdf::Model *model, bool topLevel = true)
     {
-        sim::addLog(sim_verbosity_debug, "Importing model '" + model->Name() + "'...");
+        if(topLevel && !isModelSelected(ctx, model->Name()))
+        {
+            DEBUG_LOG(ctx, "Skipping model '%s'", model->Name());
+            return;
+        }
+
+        TRACE_SPAN(ctx, "model", model->Name());
+        DEBUG_LOG(ctx, "Importing model '%s'...", model->Name());
 
         bool static_ = model->Static();
 
+        ModelTables tables(model);
+
         // import model's links starting from top-level links (i.e. those without parent link)
         for(int i = 0; i < model->LinkCount(); i++)
         {
-            const sdf::Link *link = model->LinkByIndex(i);
-            if(getParentJoint(link, model)) continue;
-            importModelLink(opts, model, link, -1);
-            visitLink(opts, model, link);
+            if(tables.linkParentJoint[i] != -1) continue;
+            if(!isLinkSelected(ctx, model->LinkByIndex(i))) continue;
+            importModelLink(ctx, tables, i, -1);
+            visitLink(ctx, tables, i);
         }
 
         for(int i = 0; i < model->ModelCount(); i++)
         {
             const sdf::Model *x = model->ModelByIndex(i);
+            if(!isModelSelected(ctx, x->Name()))
+            {
+                DEBUG_LOG(ctx, "Skipping model '%s'", x->Name());
+                continue;
+            }
             // FIXME: parent of the submodel?
-            importModel(opts, x, false);
+            ctx.hasNestedModels = true;
+            importModel(ctx, x, false);
         }
 
         for(int i = 0; i < model->LinkCount(); i++)
         {
-            const sdf::Link *link = model->LinkByIndex(i);
-            if(getParentJoint(link, model)) continue;
+            if(tables.linkParentJoint[i] != -1) continue;
+            int linkHandle = tables.linkHandles[i];
+            if(linkHandle == -1) continue;
 
             // here link has no parent (i.e. top-level for this model object)
             if(topLevel)
             {
                 // mark it as model base
-                sim::setModelProperty(linkHandle[link],
-                        sim::getModelProperty(linkHandle[link])
+                ctx.modelBases.push_back(linkHandle);
+                sim::setModelProperty(linkHandle,
+                        sim::getModelProperty(linkHandle)
                         & ~sim_modelproperty_not_model);
-                sim::setObjectProperty(linkHandle[link],
-                        sim::getObjectProperty(linkHandle[link])
+                sim::setObjectProperty(linkHandle,
+                        sim::getObjectProperty(linkHandle)
                         & ~sim_objectproperty_selectmodelbaseinstead);
             }
 
-            if(!model->SelfCollide() || opts.noSelfCollision)
-                alternateRespondableMasks(linkHandle[link]);
         }
+
+        assignRespondableMasks(ctx, tables);
+    }
+
+    string compileActorScript(ImportContext &ctx, const sdf::Actor *actor)
+    {
+        // each trajectory lasts until its last waypoint; positions follow a
+        // cardinal spline (with the tension of the trajectory) through the
+        // waypoints:
+        vector<ActorSegment> segments;
+        double offset = 0;
+        for(int i = 0; i < actor->TrajectoryCount(); i++)
+        {
+            const sdf::Trajectory *trajectory = actor->TrajectoryByIndex(i);
+            vector<std::pair<double, gz::math::Pose3d>> waypoints;
+            for(int j = 0; j < trajectory->WaypointCount(); j++)
+            {
+                const sdf::Waypoint *waypoint = trajectory->WaypointByIndex(j);
+                waypoints.emplace_back(waypoint->Time(), waypoint->Pose());
+            }
+            if(waypoints.empty()) continue;
+            std::stable_sort(waypoints.begin(), waypoints.end(), [] (const auto &a, const auto &b) { return a.first < b.first; });
+            DEBUG_LOG(ctx, "actor %s: trajectory %d (%s) has %d waypoints", actor->Name(), trajectory->Id(), trajectory->Type(), waypoints.size());
+
+            int n = waypoints.size();
+            auto position = [&] (int k)
+            {
+                const gz::math::Vector3d &p = waypoints[std::clamp(k, 0, n - 1)].second.Pos();
+                return C3Vector(p.X(), p.Y(), p.Z());
+            };
+            auto time = [&] (int k)
+            {
+                return waypoints[std::clamp(k, 0, n - 1)].first;
+            };
+            // velocity (per second) at waypoint k; with non-uniform waypoint
+            // times, the tangent of a segment is this velocity times the
+            // segment duration:
+            auto velocity = [&] (int k)
+            {
+                double dt = time(k + 1) - time(k - 1);
+                if(dt <= 0) return C3Vector(0, 0, 0);
+                return (position(k + 1) - position(k - 1)) * ((1 - trajectory->Tension()) / dt);
+            };
+            for(int k = 0; k < std::max(n - 1, 1); k++)
+            {
+                int k1 = std::min(k + 1, n - 1);
+                ActorSegment s;
+                double duration = waypoints[k1].first - waypoints[k].first;
+                s.t0 = offset + waypoints[k].first;
+                s.invDuration = duration > 0 ? 1 / duration : 0;
+                C3Vector p0 = position(k), p1 = position(k1), m0 = velocity(k) * duration, m1 = velocity(k1) * duration;
+                C3Vector coeffs[4] = {
+                    (p0 - p1) * 2 + m0 + m1,
+                    (p1 - p0) * 3 - m0 * 2 - m1,
+                    m0,
+                    p0
+                };
+                for(int c = 0; c < 4; c++)
+                    for(int j = 0; j < 3; j++)
+                        s.coeffs[c][j] = coeffs[c](j);
+                const gz::math::Quaterniond &q0 = waypoints[k].second.Rot(), &q1 = waypoints[k1].second.Rot();
+                double a[4] = {q0.X(), q0.Y(), q0.Z(), q0.W()}, b[4] = {q1.X(), q1.Y(), q1.Z(), q1.W()};
+                double dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+                // take the shortest arc:
+                double sign = dot < 0 ? -1 : 1;
+                for(int j = 0; j < 4; j++)
+                {
+                    s.q0[j] = a[j];
+                    s.q1[j] = sign * b[j];
+                }
+                s.angle = acos(std::min(1.0, fabs(dot)));
+                s.invSinAngle = sin(s.angle) > 1e-6 ? 1 / sin(s.angle) : 0;
+                segments.push_back(s);
+            }
+            offset += waypoints.back().first;
+        }
+        if(segments.empty())
+            return "";
+
+        ActorHeader header;
+        header.version = 1;
+        header.segmentCount = segments.size();
+        header.loop = actor->ScriptLoop();
+        header.autoStart = actor->ScriptAutoStart();
+        header.delayStart = actor->ScriptDelayStart();
+        header.duration = offset;
+        string data(sizeof(header) + segments.size() * sizeof(ActorSegment), '\0');
+        std::memcpy(&data[0], &header, sizeof(header));
+        std::memcpy(&data[sizeof(header)], segments.data(), segments.size() * sizeof(ActorSegment));
+        DEBUG_LOG(ctx, "actor %s: script compiled into %d segments (%g s)", actor->Name(), segments.size(), offset);
+        return data;
     }
 
-    void importActor(const ImportOptions &opts, const sdf::Actor *actor)
+    void importActor(ImportContext &ctx, const sdf::Actor *actor)
     {
-        sim::addLog(sim_verbosity_debug, "Importing actor '" + actor->Name() + "'...");
-        sim::addLog(sim_verbosity_errors, "Importing actors not currently supported");
+        TRACE_SPAN(ctx, "actor", actor->Name());
+        DEBUG_LOG(ctx, "Importing actor '%s'...", actor->Name());
+
+        int handle = sim::createDummy(0.01);
+        setSimObjectName(ctx, handle, actor->Name());
+        simMultiplyObjectMatrix(handle, getPose(ctx, actor->RawPose()));
+
+        if(ctx.opts.importVisuals && !actor->SkinFilename().empty())
+        {
+            // the skin goes through the mesh path (resolved like the meshes
+            // of a model named after the actor):
+            sdf::Model scope;
+            scope.SetName(actor->Name());
+            sdf::Mesh skin;
+            skin.SetUri(actor->SkinFilename());
+            skin.SetFilePath(actor->FilePath());
+            double scale = actor->SkinScale();
+            skin.SetScale(gz::math::Vector3d(scale, scale, scale));
+            int shapeHandle = importMeshGeometry(ctx, &scope, &skin, true, false, 0);
+            sim::setObjectParent(shapeHandle, handle, false);
+            setSimObjectName(ctx, shapeHandle, actor->Name() + "_skin");
+            ctx.stats.visualShapeCount++;
+            if(actor->AnimationCount() > 0)
+                ctx.log(sim_verbosity_warnings, formatMessage("skeletal animations of actor %s are not supported: its skin is kept in the bind pose", actor->Name()));
+        }
+
+        string script = compileActorScript(ctx, actor);
+        if(!script.empty())
+        {
+            sim::writeCustomDataBlock(handle, "sdfActor", script);
+            actorHandles.insert(handle);
+            actorsDirty = true;
+        }
+
+        sim::setModelProperty(handle, sim::getModelProperty(handle) & ~sim_modelproperty_not_model);
+        ctx.modelBases.push_back(handle);
+        ctx.stats.actorCount++;
     }
 
-    void importLight(const ImportOptions &opts, const sdf::Light *light)
+    void importLight(ImportContext &ctx, const sdf::Light *light)
     {
-        sim::addLog(sim_verbosity_debug, "Importing light '" + light->Name() + "'...");
+        DEBUG_LOG(ctx, "Importing light '%s'...", light->Name());
         sim::addLog(sim_verbosity_errors, "Importing lights not currently supported");
     }
 
-    void importSDF(const ImportOptions &opts, const sdf::Root *root)
+    void importSDF(ImportContext &ctx, const sdf::Root *root)
     {
-        sim::addLog(sim_verbosity_debug, "Importing SDF file (version " + root->Version() + ")...");
+        DEBUG_LOG(ctx, "Importing SDF file (version %s)...", root->Version());
         for(int i = 0; i < root->WorldCount(); i++)
-            importWorld(opts, root->WorldByIndex(i));
+            importWorld(ctx, root->WorldByIndex(i));
         if(root->Model())
-            importModel(opts, root->Model());
+            importModel(ctx, root->Model());
         if(root->Light())
-            importLight(opts, root->Light());
+            importLight(ctx, root->Light());
         if(root->Actor())
-            importActor(opts, root->Actor());
+            importActor(ctx, root->Actor());
     }
 
-    void import(import_in *in, import_out *out)
+    void hashImportOptions(Hash &h, const ImportOptions &o)
     {
-        std::filesystem::path modelPath = in->fileName;
-        std::filesystem::path modelDirPath = modelPath.parent_path();
-        std::filesystem::path modelsDirPath = modelDirPath.parent_path() / "models";
-
-        auto b2s = [=](const bool &b) -> std::string { return b ? "true" : "false"; };
-        sim::addLog(sim_verbosity_debug, "ImportOptions: ignoreMissingValues: %s",
-                b2s(in->options.ignoreMissingValues));
-        sim::addLog(sim_verbosity_debug, "ImportOptions: hideCollisionLinks: %s",
-                b2s(in->options.hideCollisionLinks));
-        sim::addLog(sim_verbosity_debug, "ImportOptions: hideJoints: %s",
-                b2s(in->options.hideJoints));
-        sim::addLog(sim_verbosity_debug, "ImportOptions: convexDecompose: %s",
-                b2s(in->options.convexDecompose));
-        sim::addLog(sim_verbosity_debug, "ImportOptions: showConvexDecompositionDlg: %s",
-                b2s(in->options.showConvexDecompositionDlg));
-        sim::addLog(sim_verbosity_debug, "ImportOptions: createVisualIfNone: %s",
-                b2s(in->options.createVisualIfNone));
-        sim::addLog(sim_verbosity_debug, "ImportOptions: centerModel: %s",
-                b2s(in->options.centerModel));
-        sim::addLog(sim_verbosity_debug, "ImportOptions: prepareModel: %s",
-                b2s(in->options.prepareModel));
-        sim::addLog(sim_verbosity_debug, "ImportOptions: noSelfCollision: %s",
-                b2s(in->options.noSelfCollision));
-        sim::addLog(sim_verbosity_debug, "ImportOptions: positionCtrl: %s",
-                b2s(in->options.positionCtrl));
+        h.add(int64_t(o.ignoreMissingValues));
+        h.add(int64_t(o.hideCollisionLinks));
+        h.add(int64_t(o.hideJoints));
+        h.add(int64_t(o.convexDecompose));
+        h.add(int64_t(o.showConvexDecompositionDlg));
+        h.add(int64_t(o.createVisualIfNone));
+        h.add(int64_t(o.centerModel));
+        h.add(int64_t(o.prepareModel));
+        h.add(int64_t(o.noSelfCollision));
+        h.add(int64_t(o.positionCtrl));
+        h.add(int64_t(o.compoundCollisions));
+        h.add(int64_t(o.mergeVisuals));
+        h.add(int64_t(o.maxTextureSize));
+        h.add(int64_t(o.visualLodLevels));
+        h.add(o.visualLodDistance);
+        h.add(int64_t(o.dropElements.size()));
+        for(const string &e : o.dropElements)
+            h.add(e);
+        h.add(o.archiveEntry ? *o.archiveEntry : string());
+        h.add(int64_t(o.importCollisions));
+        h.add(int64_t(o.importVisuals));
+        h.add(int64_t(o.importSensors));
+        for(const vector<string> *patterns : {&o.includeModels, &o.excludeModels, &o.includeLinks, &o.excludeLinks})
+        {
+            h.add(int64_t(patterns->size()));
+            for(const string &pattern : *patterns)
+                h.add(pattern);
+        }
+        // meshes from the geometry store don't have the colors of the mesh file:
+        h.add(int64_t(bool(o.geometryStoreDir)));
+    }
 
-        in->options.fileName = in->fileName;
+    bool getResourceStamp(const string &path, int64_t &mtime, int64_t &size)
+    {
+        std::error_code ec;
+        auto t = std::filesystem::last_write_time(path, ec);
+        if(ec) return false;
+        auto sz = std::filesystem::file_size(path, ec);
+        if(ec) return false;
+        mtime = t.time_since_epoch().count();
+        size = sz;
+        return true;
+    }
 
-        sdf::Root root;
-        sdf::setFindCallback([=] (const std::string &s) -> std::string
+    bool loadFromCache(ImportContext &ctx, const std::filesystem::path &entryDir)
+    {
+        TRACE_SPAN(ctx, "cache", "loadFromCache");
+        std::ifstream f(entryDir / "manifest");
+        string line;
+        if(!f || !std::getline(f, line) || line != "simSDF-cache 1")
+            return false;
+        vector<string> models;
+        while(std::getline(f, line))
         {
-            if(s.compare(0, 8, "model://") == 0)
+            std::istringstream ss(line);
+            string kind;
+            ss >> kind;
+            if(kind == "model")
             {
-                std::string modelName = s.substr(8);
-
-                auto p = modelsDirPath / modelName;
-                if(std::filesystem::exists(p) && std::filesystem::is_directory(p))
-                    return p.string();
+                string name;
+                ss >> name;
+                models.push_back((entryDir / name).string());
             }
-            return "";
-        });
-        sdf::Errors errors = root.Load(in->fileName);
-        if(errors.empty())
-        {
-            sim::addLog(sim_verbosity_debug, "parsed SDF successfully");
-            importSDF(in->options, &root);
+            else if(kind == "resource")
+            {
+                int64_t mtime, size, mtime1, size1;
+                string path;
+                ss >> mtime >> size;
+                ss.get();
+                std::getline(ss, path);
+                if(!getResourceStamp(path, mtime1, size1) || mtime != mtime1 || size != size1)
+                {
+                    DEBUG_LOG(ctx, "cache entry %s is stale: %s changed", entryDir.string(), path);
+                    return false;
+                }
+            }
+        }
+        if(models.empty())
+            return false;
+        vector<int> handles;
+        try
+        {
+            for(const string &m : models)
+                handles.push_back(sim::loadModel(m));
+        }
+        catch(std::exception &ex)
+        {
+            sim::addLog(sim_verbosity_warnings, "failed to load cached model: %s", ex.what());
+            for(int h : handles)
+                sim::removeModel(h);
+            return false;
+        }
+        ctx.modelBases = handles;
+        return true;
+    }
+
+    void saveToCache(ImportContext &ctx, const std::filesystem::path &entryDir)
+    {
+        TRACE_SPAN(ctx, "cache", "saveToCache");
+        if(ctx.modelBases.empty())
+            return;
+        // nested models are not parented to their model, so they would be
+        // missing from the saved models:
+        if(ctx.hasNestedModels)
+        {
+            sim::addLog(sim_verbosity_infos, "not caching %s: it has nested models", *ctx.opts.fileName);
+            return;
+        }
+        std::filesystem::create_directories(entryDir);
+        std::filesystem::path manifestPath = entryDir / "manifest";
+        std::filesystem::path tmpPath = entryDir / "manifest.tmp";
+        // unpublish a stale entry before overwriting its models:
+        std::filesystem::remove(manifestPath);
+        vector<string> names;
+        for(int i = 0; i < ctx.modelBases.size(); i++)
+        {
+            string name = "model" + std::to_string(i) + ".ttm";
+            if(sim::saveModel(ctx.modelBases[i], (entryDir / name).string()) == -1)
+                throw sim::exception("failed to save model %d", ctx.modelBases[i]);
+            names.push_back(name);
+        }
+        std::ofstream f(tmpPath);
+        f << "simSDF-cache 1" << std::endl;
+        for(const string &name : names)
+            f << "model " << name << std::endl;
+        for(const string &path : ctx.resources)
+        {
+            int64_t mtime, size;
+            if(!getResourceStamp(path, mtime, size))
+                throw sim::exception("cannot stat resource '%s'", path);
+            f << "resource " << mtime << " " << size << " " << path << std::endl;
+        }
+        f.close();
+        if(!f)
+            throw sim::exception("failed to write %s", tmpPath.string());
+        // only publish the entry once complete:
+        std::filesystem::rename(tmpPath, manifestPath);
+    }
+
+    bool tryLoadFromCache(ImportContext &ctx)
+    {
+        if(!ctx.opts.cacheDir)
+            return false;
+        Hash h;
+        h.add(string(BUILD_DATE));
+        h.add(std::filesystem::absolute(*ctx.opts.fileName).string());
+        h.add(readResource(ctx, *ctx.opts.fileName));
+        hashImportOptions(h, ctx.opts);
+        ctx.cacheEntryDir = std::filesystem::path(*ctx.opts.cacheDir) / h.hex();
+        if(!loadFromCache(ctx, ctx.cacheEntryDir))
+            return false;
+        sim::addLog(sim_verbosity_infos, "loaded %s from cache %s", *ctx.opts.fileName, ctx.cacheEntryDir.string());
+        ctx.stats.fromCache = true;
+        // the loaded models may have LODs and actors:
+        lodHandlesKnown = actorHandlesKnown = false;
+        return true;
+    }
+
+    sdf::ParserConfig getParserConfig(ImportContext &ctx)
+    {
+        std::filesystem::path modelPath = *ctx.opts.fileName;
+        std::filesystem::path modelDirPath = modelPath.parent_path();
+        std::filesystem::path modelsDirPath = modelDirPath.parent_path() / "models";
+
+        // the find callback is per parser config (rather than the global
+        // sdf::setFindCallback), so that several files can be parsed at once:
+        sdf::ParserConfig config;
+        config.SetFindCallback([=, &ctx] (const std::string &s) -> std::string
+        {
+            if(s.compare(0, 8, "model://") == 0)
+            {
+                std::string modelName = s.substr(8);
+
+                auto p = modelsDirPath / modelName;
+                if(isInArchive(ctx, p.string()))
+                {
+                    // sdformat can only load included models from files:
+                    if(ctx.archive->isDirectory(p.string().substr(ctx.archivePrefix.size())))
+                        return getLocalPath(ctx, p.string());
+                }
+                else if(std::filesystem::exists(p) && std::filesystem::is_directory(p))
+                {
+                    // track included SDF files, for cache invalidation:
+                    for(const auto &entry : std::filesystem::directory_iterator(p))
+                        if(entry.path().extension() == ".sdf")
+                            ctx.resources.insert(entry.path().string());
+                    return p.string();
+                }
+            }
+            else if(!s.empty() && s[0] != '/' && s.find("://") == string::npos)
+            {
+                // relative URIs (needed when loading a pre-filtered string,
+                // which has no file path):
+                auto p = modelDirPath / s;
+                if(resourceExists(ctx, p.string()))
+                    return getLocalPath(ctx, p.string());
+            }
+            return "";
+        });
+        return config;
+    }
+
+    // can run on a worker thread:
+    void parseSDF(ImportContext &ctx, sdf::Root &root)
+    {
+        TRACE_SPAN(ctx, "parse", *ctx.opts.fileName);
+        sdf::Errors errors;
+        bool filterModels = !ctx.opts.includeModels.empty() || !ctx.opts.excludeModels.empty();
+        if(!ctx.opts.dropElements.empty() || filterModels)
+        {
+            std::unique_ptr<std::istream> in;
+            if(isInArchive(ctx, *ctx.opts.fileName))
+                in.reset(new std::istringstream(readResource(ctx, *ctx.opts.fileName)));
+            else
+                in.reset(new std::ifstream(*ctx.opts.fileName, std::ios::binary));
+            if(!*in)
+                throw sim::exception("cannot read file %s", *ctx.opts.fileName);
+            std::set<string> dropElements(ctx.opts.dropElements.begin(), ctx.opts.dropElements.end());
+            XMLFilterStats filterStats;
+            std::function<bool(const string&)> keepModel;
+            if(filterModels)
+                keepModel = [&] (const string &name) { return isModelSelected(ctx, name); };
+            string xml = filterXML(*in, dropElements, keepModel, &filterStats);
+            DEBUG_LOG(ctx, "pre-filtered %s: %d -> %d bytes (dropped %d elements and %d models)", *ctx.opts.fileName, filterStats.inputSize, xml.size(), filterStats.droppedElements, filterStats.droppedModels);
+            errors = root.LoadSdfString(xml, getParserConfig(ctx));
+        }
+        else if(isInArchive(ctx, *ctx.opts.fileName))
+        {
+            errors = root.LoadSdfString(readResource(ctx, *ctx.opts.fileName), getParserConfig(ctx));
+        }
+        else
+        {
+            errors = root.Load(*ctx.opts.fileName, getParserConfig(ctx));
+        }
+        if(errors.empty())
+        {
+            DEBUG_LOG(ctx, "parsed SDF successfully");
         }
         else
         {
@@ -1015,22 +2768,893 @@ public:
             ss << "Errors encountered: \n";
             for(auto const &e : errors)
             {
-                sim::addLog(sim_verbosity_errors, e.Message());
+                ctx.log(sim_verbosity_errors, e.Message());
                 ss << e << "\n";
             }
             throw std::runtime_error(ss.str());
         }
     }
 
+    // can run on a worker thread: resolve the meshes of the model, and map
+    // their processed geometry from the geometry store, if available, or
+    // else decode them (STL only):
+    void prefetchMeshes(ImportContext &ctx, const sdf::Model *model)
+    {
+        if(!isModelSelected(ctx, model->Name()))
+            return;
+
+        auto prefetch = [&] (const sdf::Geometry *geometry)
+        {
+            if(geometry->Type() != sdf::GeometryType::MESH) return;
+            const sdf::Mesh *mesh = geometry->MeshShape();
+            string filename = resolveResourceFullPath(ctx, mesh->Uri(), *ctx.opts.fileName, model);
+            if(ctx.geometryStore)
+            {
+                double scalingFactors[3] = {mesh->Scale().X(), mesh->Scale().Y(), mesh->Scale().Z()};
+                string key = getGeometryKey(ctx, filename, scalingFactors);
+                if(ctx.mappedGeometry.find(key) != ctx.mappedGeometry.end()) return;
+                std::unique_ptr<GeometryStore::Entry> entry = ctx.geometryStore->find(key);
+                if(entry)
+                {
+                    ctx.mappedGeometry[key] = std::move(entry);
+                    return;
+                }
+            }
+            if(isMemoryMesh(filename))
+                decodeMesh(ctx, filename);
+        };
+        for(int i = 0; i < model->LinkCount(); i++)
+        {
+            const sdf::Link *link = model->LinkByIndex(i);
+            if(!isLinkSelected(ctx, link)) continue;
+            for(int j = 0; ctx.opts.importCollisions && j < link->CollisionCount(); j++)
+                prefetch(link->CollisionByIndex(j)->Geom());
+            for(int j = 0; ctx.opts.importVisuals && j < link->VisualCount(); j++)
+                prefetch(link->VisualByIndex(j)->Geom());
+        }
+        for(int i = 0; i < model->ModelCount(); i++)
+            prefetchMeshes(ctx, model->ModelByIndex(i));
+    }
+
+    void importParsed(ImportContext &ctx, const sdf::Root &root)
+    {
+        TRACE_SPAN(ctx, "import", *ctx.opts.fileName);
+        try
+        {
+            importSDF(ctx, &root);
+        }
+        catch(...)
+        {
+            clearTextureCache(ctx);
+            throw;
+        }
+        clearTextureCache(ctx);
+        sim::addLog(sim_verbosity_infos, "imported %d links: %d collisions -> %d collision shapes (%d pure compounds, %d merged meshes, %d active collision pairs), %d visuals -> %d visual shapes, %d textures",
+                ctx.stats.linkCount, ctx.stats.collisionCount, ctx.stats.collisionShapeCount, ctx.stats.pureCompoundCount, ctx.stats.mergedMeshCount, ctx.stats.activeCollisionPairs, ctx.stats.visualCount, ctx.stats.visualShapeCount, ctx.stats.textureCount);
+
+        if(!ctx.cacheEntryDir.empty())
+        {
+            try
+            {
+                saveToCache(ctx, ctx.cacheEntryDir);
+            }
+            catch(std::exception &ex)
+            {
+                sim::addLog(sim_verbosity_warnings, "failed to save %s to cache: %s", *ctx.opts.fileName, ex.what());
+            }
+        }
+    }
+
+    bool isDebugLogEnabled()
+    {
+        int verbosity = 0, statusbarVerbosity = 0;
+        simGetModuleInfo(PLUGIN_NAME, sim_moduleinfo_verbosity, nullptr, &verbosity);
+        simGetModuleInfo(PLUGIN_NAME, sim_moduleinfo_statusbarverbosity, nullptr, &statusbarVerbosity);
+        return std::max(verbosity, statusbarVerbosity) >= sim_verbosity_debug;
+    }
+
+    std::shared_ptr<TraceWriter> getTraceWriter(const ImportOptions &opts)
+    {
+        if(!opts.traceFile)
+            return nullptr;
+        try
+        {
+            return std::make_shared<TraceWriter>(*opts.traceFile);
+        }
+        catch(std::exception &ex)
+        {
+            throw sim::exception("%s", ex.what());
+        }
+    }
+
+    void logImportOptions(const ImportOptions &o)
+    {
+        if(!isDebugLogEnabled())
+            return;
+
+        auto b2s = [=](const bool &b) -> std::string { return b ? "true" : "false"; };
+        sim::addLog(sim_verbosity_debug, "ImportOptions: ignoreMissingValues: %s",
+                b2s(o.ignoreMissingValues));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: hideCollisionLinks: %s",
+                b2s(o.hideCollisionLinks));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: hideJoints: %s",
+                b2s(o.hideJoints));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: convexDecompose: %s",
+                b2s(o.convexDecompose));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: showConvexDecompositionDlg: %s",
+                b2s(o.showConvexDecompositionDlg));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: createVisualIfNone: %s",
+                b2s(o.createVisualIfNone));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: centerModel: %s",
+                b2s(o.centerModel));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: prepareModel: %s",
+                b2s(o.prepareModel));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: noSelfCollision: %s",
+                b2s(o.noSelfCollision));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: positionCtrl: %s",
+                b2s(o.positionCtrl));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: compoundCollisions: %s",
+                b2s(o.compoundCollisions));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: mergeVisuals: %s",
+                b2s(o.mergeVisuals));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: maxTextureSize: %d",
+                o.maxTextureSize);
+        sim::addLog(sim_verbosity_debug, "ImportOptions: visualLodLevels: %d",
+                o.visualLodLevels);
+        sim::addLog(sim_verbosity_debug, "ImportOptions: visualLodDistance: %f",
+                o.visualLodDistance);
+        sim::addLog(sim_verbosity_debug, "ImportOptions: dropElements: %s",
+                boost::algorithm::join(o.dropElements, ", "));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: archiveEntry: %s",
+                o.archiveEntry ? *o.archiveEntry : "nil");
+        sim::addLog(sim_verbosity_debug, "ImportOptions: importCollisions: %s",
+                b2s(o.importCollisions));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: importVisuals: %s",
+                b2s(o.importVisuals));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: importSensors: %s",
+                b2s(o.importSensors));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: includeModels: %s",
+                boost::algorithm::join(o.includeModels, ", "));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: excludeModels: %s",
+                boost::algorithm::join(o.excludeModels, ", "));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: includeLinks: %s",
+                boost::algorithm::join(o.includeLinks, ", "));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: excludeLinks: %s",
+                boost::algorithm::join(o.excludeLinks, ", "));
+        sim::addLog(sim_verbosity_debug, "ImportOptions: cacheDir: %s",
+                o.cacheDir ? *o.cacheDir : "nil");
+        sim::addLog(sim_verbosity_debug, "ImportOptions: geometryStoreDir: %s",
+                o.geometryStoreDir ? *o.geometryStoreDir : "nil");
+        sim::addLog(sim_verbosity_debug, "ImportOptions: geometryStoreMaxSize: %d",
+                o.geometryStoreMaxSize);
+        sim::addLog(sim_verbosity_debug, "ImportOptions: traceFile: %s",
+                o.traceFile ? *o.traceFile : "nil");
+    }
+
+    // if the file to import is an archive, open it, and replace opts.fileName
+    // (i.e. ctx.opts.fileName) with the virtual path of the SDF file inside it:
+    void openArchive(ImportContext &ctx, ImportOptions &opts)
+    {
+        if(!opts.fileName || !Archive::isArchive(*opts.fileName))
+            return;
+        std::shared_ptr<Archive> archive;
+        try
+        {
+            archive = std::make_shared<Archive>(*opts.fileName);
+        }
+        catch(std::exception &ex)
+        {
+            throw sim::exception("%s", ex.what());
+        }
+        string entry;
+        if(opts.archiveEntry)
+        {
+            entry = Archive::normalize(*opts.archiveEntry);
+            if(!archive->exists(entry))
+                throw sim::exception("archive %s has no member %s", *opts.fileName, *opts.archiveEntry);
+        }
+        else
+        {
+            // the least nested model.sdf, or else the first .sdf/.world file:
+            for(const string &name : archive->list())
+            {
+                bool isModel = name == "model.sdf" || boost::ends_with(name, "/model.sdf");
+                bool isSDF = boost::ends_with(name, ".sdf") || boost::ends_with(name, ".world");
+                if(isModel && (!boost::ends_with(entry, "model.sdf") || std::count(name.begin(), name.end(), '/') < std::count(entry.begin(), entry.end(), '/')))
+                    entry = name;
+                else if(isSDF && entry.empty())
+                    entry = name;
+            }
+            if(entry.empty())
+                throw sim::exception("archive %s does not contain any SDF file", *opts.fileName);
+        }
+        sim::addLog(sim_verbosity_infos, "importing %s from archive %s", entry, *opts.fileName);
+        opts.fileName = *opts.fileName + "/" + entry;
+        ctx.archive = archive;
+        ctx.archivePrefix = archive->path() + "/";
+    }
+
+    std::shared_ptr<GeometryStore> getGeometryStore(const ImportOptions &opts)
+    {
+        if(!opts.geometryStoreDir)
+            return nullptr;
+        return std::make_shared<GeometryStore>(*opts.geometryStoreDir, uint64_t(opts.geometryStoreMaxSize) * 1024 * 1024);
+    }
+
+    void import(import_in *in, import_out *out)
+    {
+        logImportOptions(in->options);
+
+        in->options.fileName = in->fileName;
+        ImportContext ctx(in->options);
+        openArchive(ctx, in->options);
+        ctx.geometryStore = getGeometryStore(in->options);
+        ctx.debugLog = isDebugLogEnabled();
+        ctx.trace = getTraceWriter(in->options);
+
+        if(tryLoadFromCache(ctx))
+        {
+            out->stats = ctx.stats;
+            return;
+        }
+
+        sdf::Root root;
+        parseSDF(ctx, root);
+        importParsed(ctx, root);
+        out->stats = ctx.stats;
+    }
+
+    void importBatch(importBatch_in *in, importBatch_out *out)
+    {
+        logImportOptions(in->options);
+
+        struct Job
+        {
+            ImportOptions opts;
+            std::unique_ptr<ImportContext> ctx;
+            std::unique_ptr<sdf::Root> root;
+            bool done = false;
+            bool parsed = false;
+            bool ready = false;
+            string error;
+        };
+        std::shared_ptr<GeometryStore> geometryStore = getGeometryStore(in->options);
+        std::shared_ptr<TraceWriter> trace = getTraceWriter(in->options);
+        bool debugLog = isDebugLogEnabled();
+        vector<std::unique_ptr<Job>> jobs;
+        for(const string &fileName : in->fileNames)
+        {
+            std::unique_ptr<Job> job(new Job);
+            job->opts = in->options;
+            job->opts.fileName = fileName;
+            jobs.push_back(std::move(job));
+        }
+
+        // jobs are parsed (and their meshes prefetched) on a pool of worker
+        // threads, and imported in order on the main thread. To bound the
+        // memory (decoded meshes) and file descriptors (mapped store
+        // entries) held by the contexts, parsing runs at most `window` jobs
+        // ahead of the import, and the context of a job is released once
+        // it is imported:
+        int threadCount = in->threadCount > 0 ? in->threadCount : std::max(1u, std::thread::hardware_concurrency());
+        threadCount = std::max(1, std::min<int>(threadCount, jobs.size()));
+        size_t window = 2 * threadCount;
+        std::mutex mutex;
+        std::condition_variable queued, finished;
+        std::deque<Job*> queue;
+        bool stop = false;
+        auto worker = [&]
+        {
+            while(true)
+            {
+                Job *job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    queued.wait(lock, [&] { return stop || !queue.empty(); });
+                    if(queue.empty()) return;
+                    job = queue.front();
+                    queue.pop_front();
+                }
+                try
+                {
+                    parseSDF(*job->ctx, *job->root);
+                    job->parsed = true;
+                    if(job->root->Model())
+                        prefetchMeshes(*job->ctx, job->root->Model());
+                }
+                catch(std::exception &ex)
+                {
+                    if(!job->parsed)
+                        job->error = ex.what();
+                    // errors while prefetching will surface again during import
+                }
+                catch(...)
+                {
+                    if(!job->parsed)
+                        job->error = "unknown error";
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    job->ready = true;
+                }
+                finished.notify_all();
+            }
+        };
+        vector<std::thread> threads;
+        for(int i = 0; i < threadCount; i++)
+            threads.emplace_back(worker);
+
+        // opening the archive and loading from the cache use the sim API, so
+        // are done here, when a job enters the window:
+        size_t opened = 0;
+        auto open = [&] (Job &job)
+        {
+            job.ctx.reset(new ImportContext(job.opts));
+            job.ctx->geometryStore = geometryStore;
+            job.ctx->trace = trace;
+            job.ctx->debugLog = debugLog;
+            job.root.reset(new sdf::Root);
+            try
+            {
+                openArchive(*job.ctx, job.opts);
+                job.done = tryLoadFromCache(*job.ctx);
+            }
+            catch(std::exception &ex)
+            {
+                job.error = ex.what();
+                job.done = true;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if(job.done)
+            {
+                job.ready = true;
+                return;
+            }
+            job.ctx->deferLog = true;
+            queue.push_back(&job);
+        };
+
+        // build the scene on the main thread:
+        for(size_t i = 0; i < jobs.size(); i++)
+        {
+            for(; opened < std::min(jobs.size(), i + window); opened++)
+            {
+                open(*jobs[opened]);
+                queued.notify_one();
+            }
+            Job &job = *jobs[i];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                finished.wait(lock, [&] { return job.ready; });
+            }
+            job.ctx->flushLog();
+            if(job.parsed)
+            {
+                try
+                {
+                    importParsed(*job.ctx, *job.root);
+                }
+                catch(std::exception &ex)
+                {
+                    job.error = ex.what();
+                }
+                catch(...)
+                {
+                    job.error = "unknown error";
+                }
+            }
+            ImportResult r;
+            r.fileName = *job.opts.fileName;
+            r.success = job.error.empty();
+            if(!r.success)
+            {
+                r.error = job.error;
+                sim::addLog(sim_verbosity_errors, "failed to import %s: %s", r.fileName, job.error);
+            }
+            r.stats = job.ctx->stats;
+            out->results.push_back(r);
+            job.root.reset();
+            job.ctx.reset();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        queued.notify_all();
+        for(std::thread &t : threads)
+            t.join();
+    }
+
+    // validation walks the parsed SDF like the importer does, but only runs
+    // the feature checks and URI resolution, without creating any object:
+
+    struct Validator
+    {
+        ImportContext &ctx;
+        vector<ValidationDiagnostic> &diagnostics;
+
+        void add(const string &severity, const string &element, const string &message)
+        {
+            ValidationDiagnostic d;
+            d.severity = severity;
+            d.element = element;
+            d.message = message;
+            diagnostics.push_back(d);
+        }
+
+        template<typename F>
+        void check(const string &element, F f)
+        {
+            size_t logSize = ctx.deferredLog.size();
+            try
+            {
+                f();
+            }
+            catch(std::exception &ex)
+            {
+                add("error", element, ex.what());
+            }
+            // warnings issued during the check (e.g. URIs without a scheme):
+            for(size_t i = logSize; i < ctx.deferredLog.size(); i++)
+                if(ctx.deferredLog[i].first <= sim_verbosity_warnings)
+                    add("warning", element, ctx.deferredLog[i].second);
+            ctx.deferredLog.resize(logSize);
+        }
+    };
+
+    void validateGeometry(ImportContext &ctx, Validator &v, const string &element, const sdf::Model *model, const sdf::Geometry *geometry)
+    {
+        v.check(element, [&]
+        {
+            checkGeometry(geometry);
+            if(geometry->Type() != sdf::GeometryType::MESH) return;
+            string filename = getResourceFullPath(ctx, geometry->MeshShape()->Uri(), *ctx.opts.fileName, model);
+            if(!std::filesystem::exists(filename))
+                throw sim::exception("mesh '%s' does not exist", filename);
+        });
+    }
+
+    void validateMaterial(ImportContext &ctx, Validator &v, const string &element, const sdf::Model *model, const sdf::Material *material)
+    {
+        if(!material || !material->PbrMaterial()) return;
+        const sdf::PbrWorkflow *w = material->PbrMaterial()->Workflow(sdf::PbrWorkflowType::METAL);
+        if(!w) w = material->PbrMaterial()->Workflow(sdf::PbrWorkflowType::SPECULAR);
+        if(!w || w->AlbedoMap() == "") return;
+        v.check(element, [&]
+        {
+            string sdfFile = material->FilePath() != "" ? material->FilePath() : *ctx.opts.fileName;
+            string filename = getResourceFullPath(ctx, w->AlbedoMap(), sdfFile, model);
+            if(!std::filesystem::exists(filename))
+                throw sim::exception("texture '%s' does not exist", filename);
+        });
+    }
+
+    void validateModel(ImportContext &ctx, Validator &v, const sdf::Model *model, const string &scope)
+    {
+        string modelScope = scope + model->Name();
+        for(int i = 0; i < model->LinkCount(); i++)
+        {
+            const sdf::Link *link = model->LinkByIndex(i);
+            string linkScope = modelScope + "::" + link->Name();
+            for(int j = 0; j < link->CollisionCount(); j++)
+            {
+                const sdf::Collision *collision = link->CollisionByIndex(j);
+                validateGeometry(ctx, v, linkScope + "::" + collision->Name(), model, collision->Geom());
+            }
+            for(int j = 0; j < link->VisualCount(); j++)
+            {
+                const sdf::Visual *visual = link->VisualByIndex(j);
+                validateGeometry(ctx, v, linkScope + "::" + visual->Name(), model, visual->Geom());
+                validateMaterial(ctx, v, linkScope + "::" + visual->Name(), model, visual->Material());
+            }
+            for(int j = 0; j < link->SensorCount(); j++)
+            {
+                const sdf::Sensor *sensor = link->SensorByIndex(j);
+                v.check(linkScope + "::" + sensor->Name(), [&] { checkSensor(sensor); });
+            }
+        }
+        ModelTables tables(model);
+        for(int j = 0; j < model->JointCount(); j++)
+        {
+            const sdf::Joint *joint = model->JointByIndex(j);
+            v.check(modelScope + "::" + joint->Name(), [&]
+            {
+                checkJoint(joint);
+                if(tables.jointChildLink[j] == -1)
+                    throw sim::exception("joint '%s' has an invalid child link '%s'", joint->Name(), joint->ChildName());
+            });
+        }
+        for(int i = 0; i < model->ModelCount(); i++)
+            validateModel(ctx, v, model->ModelByIndex(i), modelScope + "::");
+    }
+
+    // can run on a worker thread:
+    void validateFile(ValidationResult &result)
+    {
+        ImportOptions opts;
+        opts.fileName = result.fileName;
+        ImportContext ctx(opts);
+        ctx.deferLog = true;
+        Validator v{ctx, result.diagnostics};
+
+        sdf::Root root;
+        sdf::Errors errors = root.Load(result.fileName, getParserConfig(ctx));
+        for(auto const &e : errors)
+            v.add("error", "", e.Message());
+        if(errors.empty())
+        {
+            for(int i = 0; i < root.WorldCount(); i++)
+            {
+                const sdf::World *world = root.WorldByIndex(i);
+                v.add("warning", world->Name(), "importing worlds is not implemented yet");
+                for(int j = 0; j < world->ModelCount(); j++)
+                    validateModel(ctx, v, world->ModelByIndex(j), world->Name() + "::");
+            }
+            if(root.Model())
+                validateModel(ctx, v, root.Model(), "");
+        }
+
+        result.valid = std::none_of(result.diagnostics.begin(), result.diagnostics.end(), [] (const ValidationDiagnostic &d) { return d.severity == "error"; });
+    }
+
+    void validate(validate_in *in, validate_out *out)
+    {
+        for(const string &path : in->paths)
+        {
+            if(std::filesystem::is_directory(path))
+            {
+                vector<string> files;
+                for(const auto &entry : std::filesystem::recursive_directory_iterator(path))
+                {
+                    string ext = entry.path().extension().string();
+                    boost::algorithm::to_lower(ext);
+                    if(entry.is_regular_file() && (ext == ".sdf" || ext == ".world"))
+                        files.push_back(entry.path().string());
+                }
+                std::sort(files.begin(), files.end());
+                for(const string &file : files)
+                {
+                    out->results.emplace_back();
+                    out->results.back().fileName = file;
+                }
+            }
+            else
+            {
+                out->results.emplace_back();
+                out->results.back().fileName = path;
+            }
+        }
+
+        int threadCount = in->threadCount > 0 ? in->threadCount : std::max(1u, std::thread::hardware_concurrency());
+        threadCount = std::min<int>(threadCount, out->results.size());
+        std::atomic<size_t> next(0);
+        auto worker = [&]
+        {
+            for(size_t i = next++; i < out->results.size(); i = next++)
+            {
+                try
+                {
+                    validateFile(out->results[i]);
+                }
+                catch(std::exception &ex)
+                {
+                    ValidationDiagnostic d;
+                    d.severity = "error";
+                    d.message = ex.what();
+                    out->results[i].diagnostics.push_back(d);
+                    out->results[i].valid = false;
+                }
+            }
+        };
+        vector<std::thread> threads;
+        for(int i = 0; i < threadCount; i++)
+            threads.emplace_back(worker);
+        for(std::thread &t : threads)
+            t.join();
+
+        int invalidCount = std::count_if(out->results.begin(), out->results.end(), [] (const ValidationResult &r) { return !r.valid; });
+        sim::addLog(sim_verbosity_infos, "validated %d files: %d invalid", out->results.size(), invalidCount);
+    }
+
+    // handles of the objects with custom data of this plugin (when not
+    // known, the whole scene is scanned for them); erased objects are
+    // dropped:
+    void scanHandles(set<int> &handles, bool &known, int objectType, const vector<string> &blocks)
+    {
+        if(!known)
+        {
+            handles.clear();
+            for(int handle : sim::getObjectsInTree(sim_handle_scene, objectType, 0))
+                for(const string &block : blocks)
+                    if(!sim::readCustomDataBlock(handle, block).empty())
+                        handles.insert(handle);
+            known = true;
+        }
+        for(auto it = handles.begin(); it != handles.end();)
+            it = sim::isHandle(*it) ? std::next(it) : handles.erase(it);
+    }
+
+    void scanLodGroups()
+    {
+        lodGroups.clear();
+        lodGroupsDirty = false;
+        scanHandles(lodHandles, lodHandlesKnown, sim_sceneobject_shape, {"sdfLod", "sdfLodLevel"});
+        const set<int> &shapes = lodHandles;
+        // groups are identified by parent and tag:
+        map<std::pair<int, string>, LodGroup> groups;
+        for(int handle : shapes)
+        {
+            string data = sim::readCustomDataBlock(handle, "sdfLod");
+            size_t nl = data.find('\n');
+            if(nl == string::npos) continue;
+            LodGroup &g = groups[{sim::getObjectParent(handle), data.substr(0, nl)}];
+            std::stringstream ss(data.substr(nl + 1));
+            for(double d; ss >> d;)
+                g.distances.push_back(d);
+            g.levelHandles.resize(g.distances.size() + 1, -1);
+            g.levelHandles[0] = handle;
+        }
+        for(int handle : shapes)
+        {
+            string data = sim::readCustomDataBlock(handle, "sdfLodLevel");
+            size_t nl = data.find('\n');
+            if(nl == string::npos) continue;
+            auto it = groups.find({sim::getObjectParent(handle), data.substr(0, nl)});
+            if(it == groups.end()) continue;
+            int k = std::stoi(data.substr(nl + 1));
+            if(k > 0 && k < it->second.levelHandles.size())
+                it->second.levelHandles[k] = handle;
+        }
+        for(const auto &x : groups)
+        {
+            // skip groups with missing levels (e.g. a LOD shape was removed):
+            const vector<int> &h = x.second.levelHandles;
+            if(std::find(h.begin(), h.end(), -1) == h.end())
+                lodGroups.push_back(x.second);
+        }
+    }
+
+    void updateLods()
+    {
+        if(lodGroupsDirty)
+            scanLodGroups();
+        if(lodGroups.empty())
+            return;
+
+        int cameraHandle = simGetObject("/DefaultCamera", -1, -1, 1);
+        if(cameraHandle == -1)
+        {
+            vector<int> cameras = sim::getObjectsInTree(sim_handle_scene, sim_sceneobject_camera, 0);
+            if(cameras.empty()) return;
+            cameraHandle = cameras[0];
+        }
+        C3Vector cameraPos;
+        sim::getObjectPosition(cameraHandle, -1, cameraPos.data);
+
+        for(LodGroup &g : lodGroups)
+        {
+            C3Vector pos;
+            sim::getObjectPosition(g.levelHandles[0], -1, pos.data);
+            double distance = (pos - cameraPos).getLength();
+            int level = 0;
+            while(level < g.distances.size() && distance >= g.distances[level])
+                level++;
+            if(level == g.currentLevel) continue;
+            // only touch the layers when switching, so that manual changes
+            // are kept until the next switch:
+            for(int k = 0; k < g.levelHandles.size(); k++)
+                sim::setObjectInt32Param(g.levelHandles[k], sim_objintparam_visibility_layer, k == level ? 1 : 0);
+            g.currentLevel = level;
+        }
+    }
+
+    void scanActors()
+    {
+        actors.clear();
+        actorSegments.clear();
+        actorsDirty = false;
+        actorsTime = -1;
+        scanHandles(actorHandles, actorHandlesKnown, sim_sceneobject_dummy, {"sdfActor"});
+        for(int handle : actorHandles)
+        {
+            string data = sim::readCustomDataBlock(handle, "sdfActor");
+            if(data.size() < sizeof(ActorHeader)) continue;
+            ActorHeader header;
+            std::memcpy(&header, data.data(), sizeof(ActorHeader));
+            if(header.version != 1 || data.size() != sizeof(ActorHeader) + header.segmentCount * sizeof(ActorSegment))
+            {
+                sim::addLog(sim_verbosity_warnings, "object %d has invalid actor data", handle);
+                continue;
+            }
+            if(header.segmentCount == 0) continue;
+            ActorTrack a;
+            a.handle = handle;
+            a.firstSegment = actorSegments.size();
+            a.segmentCount = header.segmentCount;
+            a.loop = header.loop;
+            a.delayStart = header.delayStart;
+            a.duration = header.duration;
+            a.startTime = -1;
+            if(header.autoStart)
+                a.startTime = 0;
+            else if(actorStartTimes.count(handle))
+                a.startTime = actorStartTimes[handle];
+            actors.push_back(a);
+            actorSegments.resize(actorSegments.size() + header.segmentCount);
+            std::memcpy(&actorSegments[a.firstSegment], data.data() + sizeof(ActorHeader), header.segmentCount * sizeof(ActorSegment));
+        }
+        actorPoses.resize(7 * actors.size());
+    }
+
+    void updateActors()
+    {
+        if(actorsDirty)
+            scanActors();
+        if(actors.empty())
+            return;
+
+        double time = sim::getSimulationTime();
+        if(time == actorsTime)
+            return;
+        actorsTime = time;
+
+        // evaluate all the poses first, then set them:
+        for(int i = 0; i < actors.size(); i++)
+        {
+            ActorTrack &a = actors[i];
+            if(a.startTime < 0) continue;
+            double t = std::max(0.0, time - a.startTime - a.delayStart);
+            if(a.loop && a.duration > 0)
+                t = fmod(t, a.duration);
+            else
+                t = std::min(t, a.duration);
+            // time only goes forward (except when looping), so the current
+            // segment is found by advancing the cursor:
+            const ActorSegment *segments = &actorSegments[a.firstSegment];
+            if(t < segments[a.cursor].t0)
+                a.cursor = 0;
+            while(a.cursor + 1 < a.segmentCount && t >= segments[a.cursor + 1].t0)
+                a.cursor++;
+            const ActorSegment &g = segments[a.cursor];
+            double s = std::clamp((t - g.t0) * g.invDuration, 0.0, 1.0);
+            double *pose = &actorPoses[7 * i];
+            for(int j = 0; j < 3; j++)
+                pose[j] = ((g.coeffs[0][j] * s + g.coeffs[1][j]) * s + g.coeffs[2][j]) * s + g.coeffs[3][j];
+            double w0 = 1 - s, w1 = s;
+            if(g.invSinAngle > 0)
+            {
+                w0 = sin((1 - s) * g.angle) * g.invSinAngle;
+                w1 = sin(s * g.angle) * g.invSinAngle;
+            }
+            double norm = 0;
+            for(int j = 0; j < 4; j++)
+            {
+                pose[3 + j] = w0 * g.q0[j] + w1 * g.q1[j];
+                norm += pose[3 + j] * pose[3 + j];
+            }
+            norm = sqrt(norm);
+            for(int j = 0; j < 4; j++)
+                pose[3 + j] /= norm;
+        }
+
+        for(int i = 0; i < actors.size(); i++)
+        {
+            if(actors[i].startTime < 0) continue;
+            if(simSetObjectPose(actors[i].handle, sim_handle_parent, &actorPoses[7 * i]) == -1)
+                actorsDirty = true;
+        }
+    }
+
+    const LidarScanner & getLidarScanner(int handle)
+    {
+        auto it = lidars.find(handle);
+        if(it != lidars.end())
+        {
+            bool valid = true;
+            for(int h : it->second.sensorHandles)
+                valid = valid && sim::isHandle(h);
+            if(valid)
+                return it->second;
+        }
+
+        string data = sim::readCustomDataBlock(handle, "sdfLidar");
+        if(data.size() < sizeof(LidarHeader))
+            throw sim::exception("object %d is not a lidar imported from SDF", handle);
+        LidarScanner lidar;
+        std::memcpy(&lidar.header, data.data(), sizeof(LidarHeader));
+        int beamCount = lidar.header.horizontalSamples * lidar.header.verticalSamples;
+        if(lidar.header.version != 1 || data.size() != sizeof(LidarHeader) + beamCount * sizeof(LidarBeam))
+            throw sim::exception("object %d has invalid lidar data", handle);
+        lidar.lut.resize(beamCount);
+        std::memcpy(lidar.lut.data(), data.data() + sizeof(LidarHeader), beamCount * sizeof(LidarBeam));
+        lidar.sensorHandles.resize(lidar.header.sensorCount, -1);
+        for(int childHandle : sim::getObjectChildren(handle))
+        {
+            string index = sim::readCustomDataBlock(childHandle, "sdfLidarSensor");
+            if(index.empty()) continue;
+            int k = std::stoi(index);
+            if(k >= 0 && k < lidar.sensorHandles.size())
+                lidar.sensorHandles[k] = childHandle;
+        }
+        for(int h : lidar.sensorHandles)
+            if(h == -1)
+                throw sim::exception("lidar %d is missing some of its vision sensors", handle);
+        return lidars[handle] = lidar;
+    }
+
+    void getLidarScan(getLidarScan_in *in, getLidarScan_out *out)
+    {
+        const LidarScanner &lidar = getLidarScanner(in->sensorHandle);
+
+        vector<float*> depth(lidar.sensorHandles.size(), nullptr);
+        try
+        {
+            for(int k = 0; k < lidar.sensorHandles.size(); k++)
+            {
+                simHandleVisionSensor(lidar.sensorHandles[k], nullptr, nullptr);
+                int resolution[2];
+                depth[k] = simGetVisionSensorDepth(lidar.sensorHandles[k], 1 /* in meters */, nullptr, nullptr, resolution);
+                if(!depth[k])
+                    throw sim::exception("failed to read depth of vision sensor %d", lidar.sensorHandles[k]);
+            }
+
+            out->ranges.resize(lidar.lut.size());
+            for(int i = 0; i < lidar.lut.size(); i++)
+            {
+                const LidarBeam &b = lidar.lut[i];
+                float r = depth[b.sensor][b.pixel] * b.scale;
+                out->ranges[i] = r < lidar.header.rangeMax ? r : std::numeric_limits<float>::infinity();
+            }
+            out->horizontalSamples = lidar.header.horizontalSamples;
+            out->verticalSamples = lidar.header.verticalSamples;
+        }
+        catch(...)
+        {
+            for(float *d : depth)
+                if(d) simReleaseBuffer(d);
+            throw;
+        }
+        for(float *d : depth)
+            simReleaseBuffer(d);
+    }
+
+    void startActor(startActor_in *in, startActor_out *out)
+    {
+        if(sim::getSimulationState() == sim_simulation_stopped)
+            throw sim::exception("simulation is not running");
+        if(actorsDirty)
+            scanActors();
+        for(ActorTrack &a : actors)
+        {
+            if(a.handle != in->actorHandle) continue;
+            if(a.startTime < 0)
+                a.startTime = actorStartTimes[a.handle] = sim::getSimulationTime();
+            return;
+        }
+        throw sim::exception("object %d is not an actor imported from SDF with a script", in->actorHandle);
+    }
+
     void dump(dump_in *in, dump_out *out)
     {
-        throw "Not implemented in current version";
+        throw sim::exception("not implemented in current version");
     }
 
 private:
-    map<const sdf::Model*,int> modelHandle;
-    map<const sdf::Link*,int> linkHandle;
-    map<const sdf::Joint*,int> jointHandle;
+    map<int, LidarScanner> lidars;
+    vector<LodGroup> lodGroups;
+    bool lodGroupsDirty = true;
+    set<int> lodHandles;
+    bool lodHandlesKnown = false;
+    vector<ActorTrack> actors;
+    vector<ActorSegment> actorSegments;
+    vector<double> actorPoses;
+    map<int, std::array<double, 7>> actorRestPoses;
+    map<int, double> actorStartTimes;
+    bool actorsDirty = true;
+    set<int> actorHandles;
+    bool actorHandlesKnown = false;
+    double actorsTime = -1;
 };
 
 SIM_PLUGIN(Plugin)
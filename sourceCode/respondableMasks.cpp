@@ -0,0 +1,100 @@
+#include "respondableMasks.h"
+
+RespondableMasksPlan planRespondableMasks(const std::vector<std::vector<bool>> &ignore)
+{
+    const int n = ignore.size();
+    const int bitCount = 8;
+    auto active = [&] (int i, int j) { return i != j && !ignore[i][j]; };
+
+    RespondableMasksPlan plan;
+    plan.masks.assign(n, 0);
+    std::vector<std::vector<bool>> covered(n, std::vector<bool>(n, false));
+    auto uncoveredDegree = [&] (int i)
+    {
+        int d = 0;
+        for(int j = 0; j < n; j++)
+            if(active(i, j) && !covered[i][j]) d++;
+        return d;
+    };
+
+    int bit = 0;
+    for(; bit < bitCount; bit++)
+    {
+        // seed the clique with the vertex having most uncovered pairs:
+        int seed = -1, seedDegree = 0;
+        for(int i = 0; i < n; i++)
+        {
+            int d = uncoveredDegree(i);
+            if(d > seedDegree)
+            {
+                seed = i;
+                seedDegree = d;
+            }
+        }
+        if(seed == -1) break;
+
+        std::vector<int> clique{seed};
+        while(true)
+        {
+            // grow with the vertex active with all members, covering most new pairs:
+            int best = -1, bestGain = 0;
+            for(int v = 0; v < n; v++)
+            {
+                int gain = 0;
+                bool ok = true;
+                for(int u : clique)
+                {
+                    if(u == v || !active(u, v)) { ok = false; break; }
+                    if(!covered[u][v]) gain++;
+                }
+                if(ok && gain > bestGain)
+                {
+                    best = v;
+                    bestGain = gain;
+                }
+            }
+            if(best == -1) break;
+            clique.push_back(best);
+        }
+
+        for(int u : clique)
+        {
+            plan.masks[u] |= 1 << bit;
+            for(int v : clique)
+                covered[u][v] = true;
+        }
+    }
+
+    // out of bits: add each remaining active pair to a bit where it doesn't
+    // activate any ignored pair, or drop it
+    auto isSafe = [&] (int i, int b)
+    {
+        for(int k = 0; k < n; k++)
+            if(k != i && (plan.masks[k] & (1 << b)) && ignore[i][k])
+                return false;
+        return true;
+    };
+    for(int i = 0; i < n; i++)
+    {
+        for(int j = i + 1; j < n; j++)
+        {
+            if(!active(i, j) || (plan.masks[i] & plan.masks[j])) continue;
+            int b = 0;
+            while(b < bitCount && !(isSafe(i, b) && isSafe(j, b)))
+                b++;
+            if(b == bitCount)
+            {
+                plan.droppedPairs++;
+                continue;
+            }
+            plan.masks[i] |= 1 << b;
+            plan.masks[j] |= 1 << b;
+        }
+    }
+
+    for(int i = 0; i < n; i++)
+        for(int j = i + 1; j < n; j++)
+            if(plan.masks[i] & plan.masks[j])
+                plan.activePairs++;
+    return plan;
+}
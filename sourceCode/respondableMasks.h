@@ -0,0 +1,27 @@
+#ifndef SIMSDF_RESPONDABLEMASKS_H_INCLUDED
+#define SIMSDF_RESPONDABLEMASKS_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+// assignment of the 8 local bits of the respondable masks of n shapes of a
+// model: two shapes are tested for collision iff their masks share a bit,
+// so each bit is a set of shapes whose pairs are all active, and the bits
+// must cover all the active pairs (those not in ignore). This is a greedy
+// clique cover of the graph of active pairs. If 8 bits are not enough, each
+// remaining active pair is added to a bit where it doesn't activate any
+// ignored pair (e.g. links connected by a joint, which would otherwise
+// collide all the time), if there is one, and is dropped otherwise.
+
+struct RespondableMasksPlan
+{
+    std::vector<uint8_t> masks;
+    // pairs actually tested (i.e. sharing a bit):
+    int activePairs = 0;
+    // active pairs left out for lack of bits:
+    int droppedPairs = 0;
+};
+
+RespondableMasksPlan planRespondableMasks(const std::vector<std::vector<bool>> &ignore);
+
+#endif // SIMSDF_RESPONDABLEMASKS_H_INCLUDED
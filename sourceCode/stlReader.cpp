@@ -0,0 +1,80 @@
+#include "stlReader.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    class VertexMerger
+    {
+    public:
+        VertexMerger(std::vector<double> &vertices, std::vector<int> &indices)
+            : vertices(vertices), indices(indices) {}
+
+        void add(float x, float y, float z)
+        {
+            auto r = index.emplace(std::array<float, 3>{x, y, z}, int(vertices.size() / 3));
+            if(r.second)
+            {
+                vertices.push_back(x);
+                vertices.push_back(y);
+                vertices.push_back(z);
+            }
+            indices.push_back(r.first->second);
+        }
+
+    private:
+        std::vector<double> &vertices;
+        std::vector<int> &indices;
+        std::map<std::array<float, 3>, int> index;
+    };
+}
+
+void readSTL(const std::string &data, std::vector<double> &vertices, std::vector<int> &indices)
+{
+    VertexMerger merger(vertices, indices);
+
+    // binary: 80 bytes header, uint32 count, then 50 bytes per triangle
+    // (possibly followed by some padding). Some binary files start with
+    // "solid" too, so check the size first, and the text otherwise:
+    bool looksAscii = data.compare(0, 5, "solid") == 0 && data.find("facet") != std::string::npos;
+    if(data.size() >= 84)
+    {
+        uint32_t count;
+        std::memcpy(&count, &data[80], 4);
+        uint64_t size = 84 + uint64_t(count) * 50;
+        if(data.size() == size || (data.size() > size && !looksAscii))
+        {
+            for(uint32_t i = 0; i < count; i++)
+            {
+                float v[9];
+                // skip the normal:
+                std::memcpy(v, &data[84 + 50 * i + 12], sizeof(v));
+                for(int k = 0; k < 3; k++)
+                    merger.add(v[3 * k + 0], v[3 * k + 1], v[3 * k + 2]);
+            }
+            return;
+        }
+    }
+
+    if(data.compare(0, 5, "solid") != 0)
+        throw std::runtime_error("not a STL file");
+    std::istringstream in(data);
+    std::string token;
+    int n = 0;
+    while(in >> token)
+    {
+        if(token != "vertex") continue;
+        float x, y, z;
+        if(!(in >> x >> y >> z))
+            throw std::runtime_error("invalid vertex in STL file");
+        merger.add(x, y, z);
+        n++;
+    }
+    if(n % 3 != 0)
+        throw std::runtime_error("incomplete facet in STL file");
+}
@@ -0,0 +1,12 @@
+#ifndef SIMSDF_STLREADER_H_INCLUDED
+#define SIMSDF_STLREADER_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+// parse a binary or ASCII STL mesh from memory; identical vertices are
+// merged. Throws std::runtime_error if the data is not valid STL.
+
+void readSTL(const std::string &data, std::vector<double> &vertices, std::vector<int> &indices);
+
+#endif // SIMSDF_STLREADER_H_INCLUDED
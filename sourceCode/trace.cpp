@@ -0,0 +1,54 @@
+#include "trace.h"
+
+#include <stdexcept>
+
+static std::string escapeJSON(const std::string &s)
+{
+    std::string r;
+    r.reserve(s.size());
+    for(char c : s)
+    {
+        if(c == '"' || c == '\\')
+        {
+            r += '\\';
+            r += c;
+        }
+        else if(static_cast<unsigned char>(c) < 0x20)
+            r += ' ';
+        else
+            r += c;
+    }
+    return r;
+}
+
+TraceWriter::TraceWriter(const std::string &path)
+    : out(path), origin(std::chrono::steady_clock::now())
+{
+    if(!out)
+        throw std::runtime_error("failed to open trace file " + path);
+    out << "[";
+}
+
+TraceWriter::~TraceWriter()
+{
+    out << "\n]\n";
+}
+
+int64_t TraceWriter::now() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+void TraceWriter::complete(const char *category, const std::string &name, int64_t start, int64_t end)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    // small thread ids read better than the native ones in the viewer:
+    auto it = threadIds.find(std::this_thread::get_id());
+    if(it == threadIds.end())
+        it = threadIds.emplace(std::this_thread::get_id(), int(threadIds.size()) + 1).first;
+    out << (first ? "\n" : ",\n")
+        << "{\"name\":\"" << escapeJSON(name) << "\",\"cat\":\"" << category << "\",\"ph\":\"X\""
+        << ",\"ts\":" << start << ",\"dur\":" << (end - start)
+        << ",\"pid\":1,\"tid\":" << it->second << "}";
+    first = false;
+}
@@ -0,0 +1,49 @@
+#ifndef SIMSDF_TRACE_H_INCLUDED
+#define SIMSDF_TRACE_H_INCLUDED
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// writer of "complete" events in the Chrome trace event format (viewable
+// with chrome://tracing or https://ui.perfetto.dev). It can be shared by
+// several threads.
+
+class TraceWriter
+{
+public:
+    TraceWriter(const std::string &path);
+    ~TraceWriter();
+
+    int64_t now() const;
+    void complete(const char *category, const std::string &name, int64_t start, int64_t end);
+
+private:
+    std::mutex mutex;
+    std::ofstream out;
+    std::chrono::steady_clock::time_point origin;
+    std::map<std::thread::id, int> threadIds;
+    bool first = true;
+};
+
+// records the time between its construction and destruction, if tracing
+// is enabled (i.e. writer is not null):
+
+class TraceSpan
+{
+public:
+    TraceSpan(TraceWriter *writer, const char *category, const std::string &name)
+        : writer(writer), category(category), name(name), start(writer ? writer->now() : 0) {}
+    ~TraceSpan() { if(writer) writer->complete(category, name, start, writer->now()); }
+
+private:
+    TraceWriter *writer;
+    const char *category;
+    std::string name;
+    int64_t start;
+};
+
+#endif // SIMSDF_TRACE_H_INCLUDED
@@ -0,0 +1,228 @@
+#include "util.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+Hash & Hash::add(const void *data, size_t size)
+{
+    const unsigned char *p = static_cast<const unsigned char*>(data);
+    for(size_t i = 0; i < size; i++)
+    {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return *this;
+}
+
+Hash & Hash::add(const std::string &s)
+{
+    // prefix with the length, so that consecutive strings can't collide:
+    add(int64_t(s.size()));
+    return add(s.data(), s.size());
+}
+
+Hash & Hash::add(int64_t x)
+{
+    return add(&x, sizeof(x));
+}
+
+Hash & Hash::add(double x)
+{
+    return add(&x, sizeof(x));
+}
+
+std::string Hash::hex() const
+{
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << h;
+    return ss.str();
+}
+
+namespace
+{
+    const uint32_t sha256K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    uint32_t rotr(uint32_t x, int n)
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+}
+
+Sha256::Sha256()
+    : state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19}
+{
+}
+
+void Sha256::transform(const unsigned char *block)
+{
+    uint32_t w[64];
+    for(int i = 0; i < 16; i++)
+        w[i] = (uint32_t(block[4 * i]) << 24) | (uint32_t(block[4 * i + 1]) << 16) | (uint32_t(block[4 * i + 2]) << 8) | uint32_t(block[4 * i + 3]);
+    for(int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+    for(int i = 0; i < 64; i++)
+    {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + sha256K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+Sha256 & Sha256::add(const void *data, size_t size)
+{
+    const unsigned char *p = static_cast<const unsigned char*>(data);
+    length += size;
+    while(size > 0)
+    {
+        size_t n = std::min(size, sizeof(buffer) - bufferSize);
+        std::memcpy(buffer + bufferSize, p, n);
+        bufferSize += n;
+        p += n;
+        size -= n;
+        if(bufferSize == sizeof(buffer))
+        {
+            transform(buffer);
+            bufferSize = 0;
+        }
+    }
+    return *this;
+}
+
+Sha256 & Sha256::add(const std::string &s)
+{
+    // prefix with the length, so that consecutive strings can't collide:
+    int64_t size = s.size();
+    add(&size, sizeof(size));
+    return add(s.data(), s.size());
+}
+
+Sha256 & Sha256::add(double x)
+{
+    return add(&x, sizeof(x));
+}
+
+std::string Sha256::hex()
+{
+    // pad with 0x80, zeros, and the message length in bits (big endian):
+    uint64_t bits = length * 8;
+    unsigned char pad = 0x80;
+    add(&pad, 1);
+    pad = 0;
+    while(bufferSize != 56)
+        add(&pad, 1);
+    unsigned char len[8];
+    for(int i = 0; i < 8; i++)
+        len[i] = (unsigned char)(bits >> (56 - 8 * i));
+    add(len, 8);
+    std::stringstream ss;
+    for(uint32_t x : state)
+        ss << std::hex << std::setw(8) << std::setfill('0') << x;
+    return ss.str();
+}
+
+std::string readFile(const std::string &path)
+{
+    std::ifstream f(path, std::ios::binary);
+    if(!f)
+        throw std::runtime_error("cannot read file " + path);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    return ss.str();
+}
+
+bool matchGlob(const std::string &pattern, const std::string &s)
+{
+    // iterative matching with backtracking to the last '*':
+    size_t p = 0, i = 0, starP = std::string::npos, starI = 0;
+    while(i < s.size())
+    {
+        if(p < pattern.size() && (pattern[p] == '?' || pattern[p] == s[i]))
+        {
+            p++;
+            i++;
+        }
+        else if(p < pattern.size() && pattern[p] == '*')
+        {
+            starP = p++;
+            starI = i;
+        }
+        else if(starP != std::string::npos)
+        {
+            p = starP + 1;
+            i = ++starI;
+        }
+        else return false;
+    }
+    while(p < pattern.size() && pattern[p] == '*')
+        p++;
+    return p == pattern.size();
+}
+
+bool getImageSize(const std::string &data, int &width, int &height)
+{
+    auto byte = [&] (size_t i) { return i < data.size() ? uint32_t(uint8_t(data[i])) : 0u; };
+    auto be16 = [&] (size_t i) { return (byte(i) << 8) | byte(i + 1); };
+    auto be32 = [&] (size_t i) { return (be16(i) << 16) | be16(i + 2); };
+
+    // PNG: the IHDR chunk comes first
+    if(data.size() >= 24 && data.compare(0, 8, "\x89PNG\r\n\x1a\n") == 0 && data.compare(12, 4, "IHDR") == 0)
+    {
+        width = be32(16);
+        height = be32(20);
+        return true;
+    }
+
+    // JPEG: walk the segments up to a start-of-frame marker
+    if(byte(0) == 0xFF && byte(1) == 0xD8)
+    {
+        size_t i = 2;
+        while(i + 9 < data.size())
+        {
+            if(byte(i) != 0xFF) return false;
+            uint32_t marker = byte(i + 1);
+            if(marker == 0xFF) { i++; continue; }
+            if(marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+            {
+                height = be16(i + 5);
+                width = be16(i + 7);
+                return true;
+            }
+            i += 2 + be16(i + 2);
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,55 @@
+#ifndef SIMSDF_UTIL_H_INCLUDED
+#define SIMSDF_UTIL_H_INCLUDED
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// incremental 64-bit FNV-1a hash, used for cache keys:
+
+class Hash
+{
+public:
+    Hash & add(const void *data, size_t size);
+    Hash & add(const std::string &s);
+    Hash & add(int64_t x);
+    Hash & add(double x);
+    uint64_t value() const { return h; }
+    std::string hex() const;
+
+private:
+    uint64_t h = 14695981039346656037ULL;
+};
+
+// incremental SHA-256 hash, used for content addresses shared across
+// machines (where a 64-bit hash is too prone to collisions):
+
+class Sha256
+{
+public:
+    Sha256();
+    Sha256 & add(const void *data, size_t size);
+    Sha256 & add(const std::string &s);
+    Sha256 & add(double x);
+    std::string hex();
+
+private:
+    void transform(const unsigned char *block);
+
+    uint32_t state[8];
+    unsigned char buffer[64];
+    size_t bufferSize = 0;
+    uint64_t length = 0;
+};
+
+std::string readFile(const std::string &path);
+
+// shell-style wildcard match ('*' matches any sequence, '?' any character):
+
+bool matchGlob(const std::string &pattern, const std::string &s);
+
+// read the size of a PNG or JPEG image from its header, without decoding it:
+
+bool getImageSize(const std::string &data, int &width, int &height);
+
+#endif // SIMSDF_UTIL_H_INCLUDED
@@ -0,0 +1,135 @@
+#include "xmlFilter.h"
+
+#include <cctype>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+    bool endsWith(const std::string &s, const char *suffix, size_t n)
+    {
+        return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+    }
+
+    std::string getTagName(const std::string &tag)
+    {
+        size_t b = tag[1] == '/' ? 2 : 1, e = b;
+        while(e < tag.size() && !isspace(static_cast<unsigned char>(tag[e])) && tag[e] != '/' && tag[e] != '>')
+            e++;
+        return tag.substr(b, e - b);
+    }
+
+    std::string getAttribute(const std::string &tag, const std::string &name)
+    {
+        size_t i = 0;
+        while((i = tag.find(name, i + 1)) != std::string::npos)
+        {
+            if(!isspace(static_cast<unsigned char>(tag[i - 1])))
+                continue;
+            size_t j = i + name.size();
+            while(j < tag.size() && isspace(static_cast<unsigned char>(tag[j]))) j++;
+            if(j >= tag.size() || tag[j] != '=') continue;
+            j++;
+            while(j < tag.size() && isspace(static_cast<unsigned char>(tag[j]))) j++;
+            if(j >= tag.size() || (tag[j] != '"' && tag[j] != '\'')) continue;
+            size_t k = tag.find(tag[j], j + 1);
+            if(k == std::string::npos) break;
+            return tag.substr(j + 1, k - j - 1);
+        }
+        return "";
+    }
+}
+
+std::string filterXML(std::istream &in, const std::set<std::string> &dropElements, const std::function<bool(const std::string&)> &keepModel, XMLFilterStats *stats)
+{
+    XMLFilterStats localStats;
+    if(!stats) stats = &localStats;
+
+    std::istreambuf_iterator<char> it(in), end;
+    std::string out, tag;
+    std::vector<std::string> stack;
+    // nesting level inside the element being dropped (0 = not dropping):
+    int dropDepth = 0;
+
+    auto readUntil = [&] (const char *terminator, size_t n)
+    {
+        while(it != end && !endsWith(tag, terminator, n))
+        {
+            tag += *it++;
+            stats->inputSize++;
+        }
+    };
+
+    while(it != end)
+    {
+        char c = *it++;
+        stats->inputSize++;
+        if(c != '<')
+        {
+            if(!dropDepth) out += c;
+            continue;
+        }
+
+        tag = "<";
+        if(it != end && (*it == '!' || *it == '?'))
+        {
+            // comment, CDATA section, DOCTYPE or processing instruction:
+            char kind = *it++;
+            stats->inputSize++;
+            tag += kind;
+            const char *terminator = kind == '?' ? "?>" : ">";
+            if(kind == '!' && it != end && *it == '-') terminator = "-->";
+            else if(kind == '!' && it != end && *it == '[') terminator = "]]>";
+            readUntil(terminator, std::strlen(terminator));
+            if(!dropDepth) out += tag;
+            continue;
+        }
+
+        // element tag; '>' may appear inside quoted attribute values:
+        char quote = 0;
+        while(it != end && !(tag.back() == '>' && !quote))
+        {
+            char d = *it++;
+            stats->inputSize++;
+            if(quote && d == quote) quote = 0;
+            else if(!quote && (d == '"' || d == '\'')) quote = d;
+            tag += d;
+        }
+
+        bool endTag = tag[1] == '/';
+        bool selfClosing = endsWith(tag, "/>", 2);
+        if(dropDepth)
+        {
+            if(endTag) dropDepth--;
+            else if(!selfClosing) dropDepth++;
+            continue;
+        }
+        if(endTag)
+        {
+            if(!stack.empty()) stack.pop_back();
+            out += tag;
+            continue;
+        }
+
+        std::string name = getTagName(tag);
+        bool drop = dropElements.count(name) > 0;
+        if(drop)
+            stats->droppedElements++;
+        else if(name == "model" && keepModel && !stack.empty()
+                && (stack.back() == "sdf" || stack.back() == "world")
+                && !keepModel(getAttribute(tag, "name")))
+        {
+            drop = true;
+            stats->droppedModels++;
+        }
+        if(drop)
+        {
+            if(!selfClosing) dropDepth = 1;
+            continue;
+        }
+        out += tag;
+        if(!selfClosing) stack.push_back(name);
+    }
+    return out;
+}
@@ -0,0 +1,24 @@
+#ifndef SIMSDF_XMLFILTER_H_INCLUDED
+#define SIMSDF_XMLFILTER_H_INCLUDED
+
+#include <functional>
+#include <istream>
+#include <set>
+#include <string>
+
+// streaming pre-filter for SDF files, run before building the DOM: copies
+// the XML text from the input, except for the elements (and their
+// content) whose tag is in dropElements, and the models (children of
+// <sdf> or <world>) rejected by keepModel (given the model name; if not
+// set, all models are kept). The text is otherwise left untouched.
+
+struct XMLFilterStats
+{
+    size_t inputSize = 0;
+    size_t droppedElements = 0;
+    size_t droppedModels = 0;
+};
+
+std::string filterXML(std::istream &in, const std::set<std::string> &dropElements, const std::function<bool(const std::string&)> &keepModel, XMLFilterStats *stats = nullptr);
+
+#endif // SIMSDF_XMLFILTER_H_INCLUDED
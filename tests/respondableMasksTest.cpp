@@ -0,0 +1,93 @@
+#include "respondableMasks.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// checks the masks planned for the links of a kinematic tree (given as the
+// parent of each link, -1 for the root), with self-collision enabled: the
+// pairs of links connected by a joint are ignored, all other pairs are
+// active. No ignored pair may ever share a bit.
+
+int failures = 0;
+
+void check(bool condition, const std::string &test, const char *what)
+{
+    if(condition) return;
+    std::printf("FAIL %s: %s\n", test.c_str(), what);
+    failures++;
+}
+
+RespondableMasksPlan checkTree(const std::string &test, const std::vector<int> &parent)
+{
+    int n = parent.size();
+    std::vector<std::vector<bool>> ignore(n, std::vector<bool>(n, false));
+    for(int i = 0; i < n; i++)
+        if(parent[i] != -1)
+            ignore[i][parent[i]] = ignore[parent[i]][i] = true;
+
+    RespondableMasksPlan plan = planRespondableMasks(ignore);
+    check(plan.masks.size() == size_t(n), test, "one mask per link");
+    int activePairs = 0, sharedPairs = 0;
+    for(int i = 0; i < n; i++)
+    {
+        for(int j = i + 1; j < n; j++)
+        {
+            bool shared = plan.masks[i] & plan.masks[j];
+            if(ignore[i][j])
+                check(!shared, test, "ignored pair shares a bit");
+            else
+                activePairs++;
+            if(shared) sharedPairs++;
+        }
+    }
+    check(plan.activePairs == sharedPairs, test, "activePairs counts the pairs sharing a bit");
+    check(plan.activePairs + plan.droppedPairs == activePairs, test, "every active pair is either tested or dropped");
+    std::printf("%s: %d links, %d of %d active pairs tested, %d dropped\n", test.c_str(), n, plan.activePairs, activePairs, plan.droppedPairs);
+    return plan;
+}
+
+std::vector<int> chain(int n)
+{
+    std::vector<int> parent(n);
+    for(int i = 0; i < n; i++)
+        parent[i] = i - 1;
+    return parent;
+}
+
+int main()
+{
+    for(int n = 1; n <= 40; n++)
+    {
+        RespondableMasksPlan plan = checkTree("chain" + std::to_string(n), chain(n));
+        if(n <= 12)
+            check(plan.droppedPairs == 0, "chain" + std::to_string(n), "short chain fits in 8 bits");
+    }
+
+    // a wide tree: a base with 30 single links attached
+    std::vector<int> star(31, 0);
+    star[0] = -1;
+    check(checkTree("star31", star).droppedPairs == 0, "star31", "star fits in 8 bits");
+
+    // a humanoid-like tree: a torso with a head chain, two arms and two
+    // legs, each a chain of 5 links
+    std::vector<int> humanoid{-1};
+    for(int limb = 0; limb < 5; limb++)
+        for(int k = 0; k < 5; k++)
+            humanoid.push_back(k == 0 ? 0 : int(humanoid.size()) - 1);
+    checkTree("humanoid26", humanoid);
+
+    // a wide and deep tree: every link has three children, 4 levels
+    std::vector<int> ternary{-1};
+    for(int i = 0; ternary.size() < 40; i++)
+        for(int c = 0; c < 3 && ternary.size() < 40; c++)
+            ternary.push_back(i);
+    checkTree("ternary40", ternary);
+
+    if(failures)
+    {
+        std::printf("%d failures\n", failures);
+        return 1;
+    }
+    return 0;
+}